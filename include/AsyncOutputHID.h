@@ -0,0 +1,183 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyReport.h"
+#include "LatencyStats.h"
+#include "OutputHID.h"
+#include "ReportPacer.h"
+#include "ReportQueue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace hemiola
+{
+    /*!
+     * @brief output device which owns the wrapped device from a writer thread of its own, so
+     *        that writing never blocks the caller
+     *
+     * Reports are written in the order they are queued, live reports from write and bulk reports
+     * from writeBulk alike, as the edits making up a chord's word only make sense to the host in
+     * that order. If the host stops polling the queue is coalesced rather than growing without
+     * bound, so writing never blocks even then. Reports are written no closer together than the
+     * host's polling interval, so that none are merged by the host.
+     */
+    class AsyncOutputHID : public OutputHID
+    {
+    public:
+        /*!
+         * @brief CTOR wrapping the device that reports are written to, and starting the writer
+         * @param device the device to write reports to
+         * @param interval the host's polling interval, zero to not pace reports
+         */
+        explicit AsyncOutputHID (
+            std::shared_ptr<OutputHID> device,
+            const std::chrono::nanoseconds interval = std::chrono::nanoseconds::zero() );
+        AsyncOutputHID ( const AsyncOutputHID& ) = delete;
+        AsyncOutputHID ( AsyncOutputHID&& ) = delete;
+        AsyncOutputHID& operator= ( const AsyncOutputHID& ) = delete;
+        AsyncOutputHID& operator= ( AsyncOutputHID&& ) = delete;
+        ~AsyncOutputHID();
+
+        /*!
+         * @copydoc HID::open
+         */
+        void open() override;
+
+        /*!
+         * @copydoc HID::close
+         */
+        void close() override;
+
+        /*!
+         * @copydoc HID::fd
+         */
+        int fd() const override;
+
+        /*!
+         * @brief queue a live report, passed on from the keyboard
+         * @param report byte data for the keypress to send to HID output
+         * @throw IoException if the writer failed to write an earlier report
+         */
+        void write ( const KeyReport& report ) const override;
+
+        /*!
+         * @brief queue a bulk report, e.g. part of a chord's word
+         * @param report byte data for the keypress to send to HID output
+         * @throw IoException if the writer failed to write an earlier report
+         */
+        void writeBulk ( const KeyReport& report ) const override;
+
+        /*!
+         * @brief queue a run of reports at once, waking the writer only once
+         * @param reports the reports to queue, in order
+         * @param bulk true to queue them as bulk reports and false to queue them as live reports
+         * @param since the time the kernel saw the input event the reports result from
+         * @throw IoException if the writer failed to write an earlier report
+         */
+        void writeReports ( const ReportSpan& reports,
+                            const bool bulk,
+                            const TimePoint since ) const override;
+
+        /*!
+         * @brief stop the writer thread once every queued report has been written
+         * @throw IoException if the writer failed to write a report which hasn't been passed on
+         * by a later write
+         * @post the writer thread has been joined, reports the device wasn't ready for within
+         * WAIT_INTERVAL of stopping are discarded
+         */
+        void stop();
+
+        /*!
+         * @brief time from the input event each report results from to the report being written
+         *        to the device, or from it being queued for reports written without one
+         * @return statistics for all reports written so far
+         */
+        LatencyStats latency() const;
+
+        /*!
+         * @brief the rate chords' words have been typed out at
+         * @return characters per second, or zero if nothing has been typed
+         */
+        double charactersPerSecond() const;
+
+        /*!
+         * @brief how long the writer waits for the device between attempts to write a report
+         */
+        static constexpr std::chrono::milliseconds WAIT_INTERVAL { 100 };
+
+    private:
+        /*!
+         * @brief queue reports and wake the writer
+         * @param reports the reports to queue
+         * @param bulk true if the reports are bulk reports
+         * @param since the time the reports' latency is measured from
+         */
+        void push ( const ReportSpan& reports, const bool bulk, const TimePoint since ) const;
+
+        /*!
+         * @brief write queued reports until told to stop
+         */
+        void writeLoop();
+
+        /*!
+         * @brief the device to write to
+         */
+        std::shared_ptr<OutputHID> m_Device;
+
+        /*!
+         * @brief reports waiting to be written, in order, along with the time their latency is
+         * measured from
+         */
+        mutable ReportQueue m_Pending;
+
+        /*!
+         * @brief latency of written reports
+         */
+        LatencyStats m_Latency;
+
+        /*!
+         * @brief spaces reports out to the host's polling interval and measures typing speed
+         */
+        ReportPacer m_Pacer;
+
+        /*!
+         * @brief the first error the writer ran in to, rethrown to whoever writes next
+         */
+        mutable std::exception_ptr m_Error;
+
+        // Flag telling the writer thread to exit
+        bool m_Stop;
+
+        // Mutex protecting the queues, statistics and flags
+        mutable std::mutex m_Mutex;
+
+        // Wakes the writer when a report is queued or it should stop
+        mutable std::condition_variable m_Wakeup;
+
+        // Thread writing to the device
+        std::thread m_Writer;
+    };
+}  // namespace hemiola
@@ -0,0 +1,147 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyReport.h"
+#include "LatencyStats.h"
+#include "OutputHID.h"
+#include "ReportPacer.h"
+#include "ReportQueue.h"
+
+#include <chrono>
+#include <memory>
+
+namespace hemiola
+{
+    /*!
+     * @brief output device which queues reports until the wrapped device is ready to be written
+     *        to, so that writing never blocks an event loop
+     */
+    class BufferedOutputHID : public OutputHID
+    {
+    public:
+        /*!
+         * @brief CTOR wrapping the device that reports are eventually written to
+         * @param device the device to write reports to
+         * @param interval the host's polling interval, zero to not pace reports
+         */
+        explicit BufferedOutputHID (
+            std::shared_ptr<OutputHID> device,
+            const std::chrono::nanoseconds interval = std::chrono::nanoseconds::zero() );
+        BufferedOutputHID ( const BufferedOutputHID& ) = delete;
+        BufferedOutputHID ( BufferedOutputHID&& ) = delete;
+        BufferedOutputHID& operator= ( const BufferedOutputHID& ) = delete;
+        BufferedOutputHID& operator= ( BufferedOutputHID&& ) = delete;
+        ~BufferedOutputHID() = default;
+
+        /*!
+         * @copydoc HID::open
+         */
+        void open() override;
+
+        /*!
+         * @copydoc HID::close
+         */
+        void close() override;
+
+        /*!
+         * @copydoc HID::fd
+         */
+        int fd() const override;
+
+        /*!
+         * @brief queue a report to be written once the device is writable
+         * @param report byte data for the keypress to send to HID output
+         */
+        void write ( const KeyReport& report ) const override;
+
+        /*!
+         * @brief queue a report which is part of a chord's word, to be written once the device is
+         *        writable
+         * @param report byte data for the keypress to send to HID output
+         */
+        void writeBulk ( const KeyReport& report ) const override;
+
+        /*!
+         * @brief queue a run of reports to be written once the device is writable
+         * @param reports the reports to queue, in order
+         * @param bulk true if the reports are part of a chord's word
+         * @param since the time the kernel saw the input event the reports result from
+         */
+        void writeReports ( const ReportSpan& reports,
+                            const bool bulk,
+                            const TimePoint since ) const override;
+
+        /*!
+         * @brief check if there are reports waiting to be written
+         * @return true if there is at least one queued report
+         */
+        bool pending() const { return !m_Pending.empty(); }
+
+        /*!
+         * @brief the earliest time the next report may be written, so that the host sees each
+         *        report on a poll of its own
+         */
+        ReportPacer::TimePoint nextWrite() const { return m_Pacer.next; }
+
+        /*!
+         * @brief write the oldest queued report to the device, if it is ready for it
+         * @throw IoException if we are unable to write to device
+         * @post the written report is removed from the queue and its latency recorded, or it is
+         * left queued if the device wasn't ready
+         */
+        void flush();
+
+        /*!
+         * @brief time from the input event each report results from to the report being written
+         *        to the device, or from it being queued for reports written without one
+         * @return statistics for all reports written so far
+         */
+        const LatencyStats& latency() const { return m_Latency; }
+
+        /*!
+         * @brief the rate chords' words have been typed out at
+         * @return characters per second, or zero if nothing has been typed
+         */
+        double charactersPerSecond() const { return m_Pacer.charactersPerSecond(); }
+
+    private:
+        /*!
+         * @brief the device to write to
+         */
+        std::shared_ptr<OutputHID> m_Device;
+
+        /*!
+         * @brief reports waiting to be written along with the time their latency is measured
+         * from
+         */
+        mutable ReportQueue m_Pending;
+
+        /*!
+         * @brief latency of written reports
+         */
+        LatencyStats m_Latency;
+
+        /*!
+         * @brief spaces reports out to the host's polling interval and measures typing speed
+         */
+        ReportPacer m_Pacer;
+    };
+}  // namespace hemiola
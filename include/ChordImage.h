@@ -0,0 +1,303 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyMask.h"
+#include "KeyReport.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hemiola
+{
+    /*!
+     * @brief a dictionary entry, compiled when the chord map is built so that it can be output
+     *        without any further lookups
+     * @note this is stored in compiled dictionaries as is, so only holds fixed size integers
+     */
+    struct Chord
+    {
+        /*!
+         * @brief offset of the word the chord produces in the dictionary's string arena
+         */
+        uint32_t word;
+
+        /*!
+         * @brief length of the word in bytes
+         */
+        uint32_t wordLength;
+
+        /*!
+         * @brief index of the first report typing out word in the dictionary's reports
+         */
+        uint32_t firstReport;
+
+        /*!
+         * @brief number of reports typing out word, a press and a release for each character
+         */
+        uint32_t reportCount;
+    };
+
+    /*!
+     * @brief a slot of a compiled dictionary's hash table, which is free if its chord is empty
+     */
+    struct ChordSlot
+    {
+        KeyMask chord;
+        Chord entry;
+    };
+
+    /*!
+     * @brief the start of a compiled dictionary, saying where everything else is
+     * @note offsets are from the start of the dictionary, and every section is 8 byte aligned
+     */
+    struct ChordImageHeader
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        /*!
+         * @brief ENDIAN as written by the compiler, so an image from a machine of the other byte
+         * order is refused
+         */
+        uint32_t endian;
+        /*!
+         * @brief FNV-1a hash of everything after the header
+         */
+        uint32_t checksum;
+        uint32_t size;
+        /*!
+         * @brief the keys used for the special inputs in chords
+         */
+        uint32_t dup;
+        uint32_t plural;
+        uint32_t past;
+        /*!
+         * @brief number of slots in the hash table, a power of two
+         */
+        uint32_t slotCount;
+        uint32_t chordCount;
+        uint32_t reportCount;
+        /*!
+         * @brief number of entries in the key index, one for each key of each chord
+         */
+        uint32_t indexCount;
+        uint32_t arenaSize;
+        uint32_t slotsOffset;
+        uint32_t reportsOffset;
+        /*!
+         * @brief KeyMask::SIZE + 1 positions in the key index, the chords containing key k being
+         * the entries from keyStarts[k] up to keyStarts[k + 1]
+         */
+        uint32_t keyStartsOffset;
+        uint32_t indexOffset;
+        uint32_t arenaOffset;
+        /*!
+         * @brief always 0, pads the header to a multiple of 8 bytes
+         */
+        uint32_t reserved;
+    };
+
+    /*!
+     * @brief the input of ChordImage::compile for a single chord
+     */
+    struct ChordSource
+    {
+        KeyMask chord;
+        std::string word;
+        std::vector<KeyReport> reports;
+    };
+
+    /*!
+     * @brief range of slot positions in a compiled dictionary's key index
+     */
+    struct IndexSpan
+    {
+        const uint32_t* first;
+        std::size_t count;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return first + count; }
+        std::size_t size() const { return count; }
+    };
+
+    /*!
+     * @brief a compiled chord dictionary: a hash table of chords, the reports typing out their
+     *        words and the words themselves, used in place either from memory or mapped from a
+     *        file
+     */
+    class ChordImage
+    {
+    public:
+        /*!
+         * @brief version of the layout, bumped whenever it changes
+         */
+        static constexpr uint32_t VERSION = 1;
+
+        /*!
+         * @brief written to each image, so the byte order of the machine using it can be checked
+         */
+        static constexpr uint32_t ENDIAN = 0x01020304;
+
+        /*!
+         * @brief use a dictionary compiled in to memory
+         * @param bytes the dictionary, as returned by compile
+         * @throw DictionaryException if bytes isn't a valid dictionary
+         */
+        explicit ChordImage ( std::vector<uint8_t> bytes );
+
+        /*!
+         * @brief map a compiled dictionary from a file, read only
+         * @param path the file written by save
+         * @throw IoException if the file can't be mapped
+         * @throw DictionaryException if the file isn't a valid dictionary
+         */
+        explicit ChordImage ( const std::string& path );
+
+        /*!
+         * @brief use a dictionary which is compiled in to hemiola in place
+         * @param data the dictionary, which must be 8 byte aligned and outlive the image
+         * @param size the size of the dictionary in bytes
+         * @throw DictionaryException if data isn't a valid dictionary
+         */
+        ChordImage ( const uint8_t* data, const std::size_t size );
+        ChordImage ( const ChordImage& ) = delete;
+        ChordImage ( ChordImage&& ) = delete;
+        ChordImage& operator= ( const ChordImage& ) = delete;
+        ChordImage& operator= ( ChordImage&& ) = delete;
+        ~ChordImage();
+
+        /*!
+         * @brief compile chords in to a dictionary
+         * @param chords the chords, which must all be different and not empty
+         * @param dup the key used for the special input dup
+         * @param plural the key used for the special input plural
+         * @param past the key used for the special input past
+         * @return the dictionary, to be used with the ChordImage CTOR or saved
+         */
+        static std::vector<uint8_t> compile ( const std::vector<ChordSource>& chords,
+                                              const uint32_t dup,
+                                              const uint32_t plural,
+                                              const uint32_t past );
+
+        /*!
+         * @brief write the dictionary to a file, for mapping later
+         * @param path where to write the dictionary
+         * @throw IoException if the file can't be written
+         */
+        void save ( const std::string& path ) const;
+
+        /*!
+         * @brief look up a chord
+         * @param chord the keys making up the chord
+         * @return the chord's entry, or nullptr if there is none
+         */
+        const Chord* find ( const KeyMask& chord ) const;
+
+        /*!
+         * @brief the word a chord produces
+         */
+        std::string_view word ( const Chord& chord ) const
+        {
+            return std::string_view { m_Arena + chord.word, chord.wordLength };
+        }
+
+        /*!
+         * @brief the reports typing out a chord's word
+         */
+        ReportSpan reports ( const Chord& chord ) const
+        {
+            return ReportSpan { m_Reports + chord.firstReport, chord.reportCount };
+        }
+
+        /*!
+         * @brief the slots of the chords containing a key
+         * @assumption key is in range of KeyMask
+         */
+        IndexSpan chordsWith ( const unsigned int key ) const
+        {
+            return IndexSpan { m_Index + m_KeyStarts [key],
+                               m_KeyStarts [key + 1] - m_KeyStarts [key] };
+        }
+
+        /*!
+         * @brief the chord in a slot
+         */
+        const KeyMask& chord ( const uint32_t slot ) const { return m_Slots [slot].chord; }
+
+        /*!
+         * @brief the entry of the chord in a slot
+         */
+        const Chord& entry ( const uint32_t slot ) const { return m_Slots [slot].entry; }
+
+        /*!
+         * @brief number of chords in the dictionary
+         */
+        std::size_t size() const { return m_Header->chordCount; }
+
+        /*!
+         * @brief the header, e.g. for the keys used for the special inputs
+         */
+        const ChordImageHeader& header() const { return *m_Header; }
+
+        /*!
+         * @brief the dictionary as compiled, header().size bytes long
+         */
+        const uint8_t* data() const { return m_Data; }
+
+        /*!
+         * @brief hash of a chord, the same on every machine as it is stored in dictionaries
+         */
+        static uint32_t hash ( const KeyMask& chord );
+
+    private:
+        /*!
+         * @brief check the dictionary in m_Data and point the sections at it
+         * @throw DictionaryException if it isn't a valid dictionary
+         */
+        void attach();
+
+        /*!
+         * @brief the dictionary when compiled in to memory
+         */
+        std::vector<uint8_t> m_Bytes;
+
+        /*!
+         * @brief the dictionary when mapped from a file, or nullptr
+         */
+        void* m_Mapped;
+
+        /*!
+         * @brief the dictionary, in m_Bytes or m_Mapped, and its size
+         */
+        const uint8_t* m_Data;
+        std::size_t m_Size;
+
+        const ChordImageHeader* m_Header;
+        const ChordSlot* m_Slots;
+        const KeyReport* m_Reports;
+        const uint32_t* m_KeyStarts;
+        const uint32_t* m_Index;
+        const char* m_Arena;
+    };
+}  // namespace hemiola
@@ -0,0 +1,139 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "Settings.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace hemiola
+{
+    /*!
+     * @brief running statistics of the gaps between key presses, recent gaps count the most
+     */
+    struct GapStats
+    {
+        using Duration = std::chrono::steady_clock::duration;
+
+        /*!
+         * @brief number of gaps recorded
+         */
+        std::size_t count { 0 };
+
+        /*!
+         * @brief mean gap in milliseconds
+         */
+        double mean { 0.0 };
+
+        /*!
+         * @brief variance of the gap in milliseconds squared
+         */
+        double variance { 0.0 };
+
+        /*!
+         * @brief record a gap between two key presses
+         */
+        void add ( const Duration gap );
+    };
+
+    /*!
+     * @brief class which chooses how long to wait for more keys before a held chord is output
+     */
+    class ChordTiming
+    {
+    public:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        /*!
+         * @brief chords with more keys than this share the thresholds of the largest size
+         */
+        static constexpr std::size_t MAX_CHORD_SIZE { 10 };
+
+        explicit ChordTiming ( const Settings& settings );
+
+        /*!
+         * @brief the time to wait for another key once a chord has the given number of keys
+         * @param size the number of keys captured so far
+         * @return the configured threshold, or the learned one in adaptive mode
+         */
+        std::chrono::milliseconds threshold ( const std::size_t size ) const;
+
+        /*!
+         * @brief learn from the press times of a chord of two or more keys
+         * @param presses the time each key of the chord was pressed, in any order
+         * @param count the number of keys in the chord
+         * @post presses is sorted, which is done in place so that nothing is allocated
+         */
+        void addChord ( TimePoint* presses, const std::size_t count );
+
+        /*!
+         * @brief learn from the gap between two keys which were typed rather than chorded
+         * @param gap time between the two key presses
+         */
+        void addTyping ( const GapStats::Duration gap );
+
+        /*!
+         * @brief the learned threshold for each chord size, starting with a single key
+         */
+        const std::array<std::chrono::milliseconds, MAX_CHORD_SIZE>& thresholds() const
+        {
+            return m_Thresholds;
+        }
+
+        /*!
+         * @brief statistics of the gap between the n-th and the next key of a chord
+         */
+        const std::array<GapStats, MAX_CHORD_SIZE>& chordGaps() const { return m_ChordGaps; }
+
+        /*!
+         * @brief statistics of the gap between typed keys
+         */
+        const GapStats& typingGaps() const { return m_TypingGaps; }
+
+    private:
+        /*!
+         * @brief recompute the threshold for the given chord size from the gaps learned so far
+         * @param index the chord size less one
+         */
+        void updateThreshold ( const std::size_t index );
+
+        /*!
+         * @brief thresholds and bounds to use
+         */
+        Settings m_Settings;
+
+        /*!
+         * @brief gaps within chords, indexed by the number of keys pressed before the gap less one
+         */
+        std::array<GapStats, MAX_CHORD_SIZE> m_ChordGaps;
+
+        /*!
+         * @brief gaps between typed keys
+         */
+        GapStats m_TypingGaps;
+
+        /*!
+         * @brief the learned thresholds, indexed by chord size less one
+         */
+        std::array<std::chrono::milliseconds, MAX_CHORD_SIZE> m_Thresholds;
+    };
+}
@@ -0,0 +1,132 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyEvent.h"
+#include "KeyReport.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace hemiola
+{
+    /*!
+     * @brief a key event along with the state of the keyboard after it
+     */
+    struct QueuedEvent
+    {
+        KeyReport report;
+        KeyEvent event;
+    };
+
+    /*!
+     * @brief class handing key events from the capture thread over to the thread running the
+     *        chord engine, without the capture thread ever waiting on the engine
+     */
+    class EventQueue
+    {
+    public:
+        /*!
+         * @brief number of events which can be waiting for the engine
+         */
+        static constexpr std::size_t CAPACITY = 1024;
+
+        EventQueue() = default;
+        EventQueue ( const EventQueue& ) = delete;
+        EventQueue ( EventQueue&& ) = delete;
+        EventQueue& operator= ( const EventQueue& ) = delete;
+        EventQueue& operator= ( EventQueue&& ) = delete;
+        ~EventQueue() = default;
+
+        /*!
+         * @brief queue an event for the engine, only to be called from the capture thread
+         * @param report the state of the keyboard after the event
+         * @param event the key that went down or up
+         * @note this only waits if the queue is full, i.e. the engine has fallen CAPACITY events
+         * behind
+         */
+        void push ( const KeyReport& report, const KeyEvent& event );
+
+        /*!
+         * @brief hand queued events to the engine until stop is called, sleeping while there
+         *        are none
+         * @param onEvent function which processes each event, called in the order they were
+         * queued
+         * @post every event queued before stop was called has been processed
+         */
+        void run ( const std::function<void ( const KeyReport&, const KeyEvent& )>& onEvent );
+
+        /*!
+         * @brief tell run to return once the events already queued have been processed
+         */
+        void stop();
+
+        /*!
+         * @brief the number of events currently waiting for the engine
+         */
+        std::size_t depth() const { return m_Ring.depth(); }
+
+        /*!
+         * @brief the most events that have been waiting for the engine at once
+         */
+        std::size_t highWater() const { return m_Ring.highWater(); }
+
+        /*!
+         * @brief the number of times the capture thread found the queue full
+         */
+        std::size_t overflows() const { return m_Overflows.load ( std::memory_order_relaxed ); }
+
+    private:
+        /*!
+         * @brief wake the engine thread if it is sleeping
+         */
+        void wake();
+
+        /*!
+         * @brief the queued events
+         */
+        SpscRing<QueuedEvent, CAPACITY> m_Ring;
+
+        /*!
+         * @brief true while the engine thread is, or is about to start, sleeping
+         */
+        alignas ( CACHE_LINE ) std::atomic<bool> m_Sleeping { false };
+
+        /*!
+         * @brief flag telling run to return
+         */
+        std::atomic<bool> m_Stop { false };
+
+        /*!
+         * @brief the number of times the capture thread found the queue full
+         */
+        std::atomic<std::size_t> m_Overflows { 0 };
+
+        // Mutex only taken to put the engine thread to sleep and to wake it
+        std::mutex m_Mutex;
+
+        // Wakes the engine thread when an event is queued or it should stop
+        std::condition_variable m_Wakeup;
+    };
+}
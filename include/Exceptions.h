@@ -43,6 +43,25 @@ namespace hemiola
         std::string m_Msg;
     };
 
+    /*!
+     * @brief Exception to be used when a compiled chord dictionary can't be used.
+     */
+    class DictionaryException : public std::exception
+    {
+    public:
+        explicit DictionaryException ( const std::string& msg )
+            : m_Msg { msg }
+        {}
+
+        virtual const char* what() const noexcept { return m_Msg.c_str(); }
+
+    private:
+        /*!
+         * @brief string associated with the exception
+         */
+        std::string m_Msg;
+    };
+
     /*!
      * @brief An exception that has an event code associated with it, such as errno.
      * @note This is intended to be the base class for other coded exceptions that likely will use
@@ -70,17 +89,6 @@ namespace hemiola
         int m_Code;
     };
 
-    /*!
-     * @brief An exception used for when trying to execute an external process
-     */
-    class ExecutionException : public CodedException
-    {
-    public:
-        ExecutionException ( const std::string& msg, const int code )
-            : CodedException ( msg, code )
-        {}
-    };
-
     /*!
      * @brief An exception used for when trying to do IO
      */
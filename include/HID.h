@@ -54,6 +54,12 @@ namespace hemiola
          */
         virtual void close();
 
+        /*!
+         * @brief file descriptor of the device, e.g. for use with poll or epoll
+         * @return the file descriptor or -1 if the device has not been opened
+         */
+        virtual int fd() const { return m_HIDId; }
+
     protected:
         /*!
          * @copydoc HID::open()
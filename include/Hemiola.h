@@ -17,18 +17,27 @@
   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
   SOFTWARE.
 */
+#pragma once
 
+#include "ChordTiming.h"
 #include "KeyChords.h"
+#include "KeyEvent.h"
+#include "KeyMask.h"
+#include "KeyReport.h"
 #include "KeyTable.h"
+#include "LatencyStats.h"
 #include "OutputHID.h"
+#include "Settings.h"
 
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <string>
 #include <thread>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace hemiola
@@ -43,7 +52,8 @@ namespace hemiola
 
         Hemiola ( std::shared_ptr<KeyTable> keyTable,
                   std::shared_ptr<KeyChords> keyChords,
-                  std::shared_ptr<OutputHID> output );
+                  std::shared_ptr<OutputHID> output,
+                  const Settings& settings = Settings {} );
         Hemiola ( const Hemiola& ) = delete;
         Hemiola ( Hemiola&& ) = delete;
         Hemiola& operator= ( const Hemiola& ) = delete;
@@ -51,25 +61,148 @@ namespace hemiola
         ~Hemiola();
 
         /*!
-         * @brief add the key press to the captured string
-         * @param key representation of key press
-         * @post if key presses occur in succession in less than the given threshold the captured
-         * keys are converted to a word and out put to the output device
+         * @brief forward a report from the keyboard to the output device and add its key to the
+         *        chord being captured
+         * @param report the state of the keyboard after the event
+         * @param event the key that went down or up
+         * @post in hold back mode keys which could be part of a chord are left out of the report
+         * until it is known whether they make up a chord, or they have been held for the maximum
+         * hold time, other keys and shortcuts are passed on straight away
          */
-        void addKey ( const unsigned int key );
+        void addEvent ( const KeyReport& report, const KeyEvent& event );
 
         /*!
-         * @brief return a set of the currently captured keys
+         * @brief add a key press or release to the chord being captured
+         * @param event the key that went down or up
+         * @post keys whose presses overlap make up a chord, and once the last of them is released
+         * the chord is converted to a word and out put to the output device. A chord which isn't
+         * part of any larger chord is output as soon as its last key is pressed
+         * @note keys are timed by the time the kernel saw them where the event carries it, and
+         * otherwise by the time they are processed
+         */
+        void addKey ( const KeyEvent& event );
+
+        /*!
+         * @brief return a set of the keys in the chord currently being captured
          * @return set of captured keys
          */
-        const std::unordered_map<unsigned int, TimePoint>& captured() const { return m_Captured; };
+        const KeyMask& captured() const { return m_Captured; };
+
+        /*!
+         * @brief the chord timing learned so far, for inspection
+         * @return a copy of the current thresholds and the statistics they were learned from
+         */
+        ChordTiming timing();
+
+        /*!
+         * @brief time from the kernel seeing a key to it being processed, for keys which carry
+         *        the time the kernel saw them
+         * @return a copy of the statistics for all such keys processed so far
+         */
+        LatencyStats inputDelay();
 
         /*!
          * @brief Function which runs the timer and grabs keychords
+         * @post a timer thread is running which sleeps until the captured chord times out, or
+         * indefinitely if nothing has been captured
          */
         void run();
 
+        /*!
+         * @brief stop the timer thread started by run
+         * @post the timer thread has been joined and no further chords will be output
+         */
+        void stop();
+
+        /*!
+         * @brief the time at which the captured chord times out, for driving Hemiola without run
+         * @return the timeout or TimePoint::max() if nothing has been captured
+         */
+        TimePoint deadline();
+
+        /*!
+         * @brief output the captured chord if it has timed out by now
+         * @param now the current time
+         * @note this is what the timer thread does on each wake up, and is used instead of run
+         * when Hemiola is driven from an event loop
+         */
+        void poll ( const TimePoint now );
+
     private:
+        /*!
+         * @brief update the captured chord with a key press or release
+         * @param event the key that went down or up
+         * @post any reports for the host which result from the event are queued in m_Burst
+         * @assumption m_Mutex is held by the caller
+         */
+        void updateChord ( const KeyEvent& event );
+
+        /*!
+         * @brief the time at which the captured chord times out
+         * @return the timeout or TimePoint::max() if nothing has been captured
+         * @assumption m_Mutex is held by the caller
+         */
+        TimePoint nextDeadline() const;
+
+        /*!
+         * @brief output the captured chord if no key has been pressed within the time threshold,
+         *        and release keys which have been held back for the maximum hold time
+         * @param now the time to compare the captured keys against
+         * @note this is only a fallback for when a release goes missing or a chord is held down,
+         * chords normally complete when their last key is released
+         * @assumption m_Mutex is held by the caller
+         */
+        void expireKeys ( const TimePoint now );
+
+        /*!
+         * @brief finish the captured chord, queueing the edit which replaces whatever the host was
+         *        sent for it with the chord's word
+         * @post m_Captured, m_Typed and m_HeldBack are empty
+         * @assumption m_Mutex is held by the caller
+         */
+        void takeChord();
+
+        /*!
+         * @brief queue the keys which have been held back, as they turned out not to be a chord
+         * @post m_HeldBack is empty and its keys have been moved to m_Typed
+         * @assumption m_Mutex is held by the caller
+         */
+        void releaseHeldBack();
+
+        /*!
+         * @brief learn the timing of the keys captured before they are output
+         * @param chord the captured keys
+         * @assumption m_Mutex is held by the caller
+         */
+        void learnTiming ( const KeyMask& chord );
+
+        /*!
+         * @brief remove the withheld keys from a report from the keyboard
+         * @param report the report to filter
+         * @return the report the host should see
+         * @assumption m_Mutex is held by the caller
+         */
+        KeyReport withhold ( KeyReport report ) const;
+
+        /*!
+         * @brief queue a report to be written to the output device
+         * @param report the report to write
+         * @param bulk true if the report is part of a chord's word, and false if it is passed on
+         * from the keyboard
+         * @assumption m_Mutex is held by the caller
+         */
+        void queue ( const KeyReport& report, const bool bulk = false );
+
+        /*!
+         * @brief write all queued reports to the output device as a single burst
+         * @param lock the lock held on m_Mutex, which is released before writing
+         * @param since the time the kernel saw the event the reports result from, if it is known,
+         * which their latency is measured from
+         * @post lock is no longer held
+         */
+        void writeBurst ( std::unique_lock<std::mutex>& lock,
+                          const TimePoint since = TimePoint {} );
+
         /*!
          * @brief remove the most recent key in m_Captured, including any surrounding modifiers
          * @post the most recent key and any surrounding modifiers are removed from m_Captured
@@ -77,9 +210,104 @@ namespace hemiola
         void deleteKey();
 
         /*!
-         * @brief the currently captured text
+         * @brief the keys making up the chord currently being captured
+         */
+        KeyMask m_Captured;
+
+        /*!
+         * @brief the keys which are currently held down
+         */
+        KeyMask m_Held;
+
+        /*!
+         * @brief the press reports the host has been sent for the captured chord, in order
+         */
+        std::vector<KeyReport> m_Typed;
+
+        /*!
+         * @brief the press reports of keys which haven't been sent to the host yet, in order
          */
-        std::unordered_map<unsigned int, TimePoint> m_Captured;
+        std::vector<KeyReport> m_HeldBack;
+
+        /*!
+         * @brief keys which are left out of the reports from the keyboard
+         */
+        KeyMask m_Withheld;
+
+        /*!
+         * @brief the time the first key in m_HeldBack was pressed
+         */
+        TimePoint m_HoldStart;
+
+        /*!
+         * @brief hold back keys which could be part of a chord instead of passing them on
+         */
+        bool m_HoldBack;
+
+        /*!
+         * @brief the longest a key is held back before it is passed on anyway
+         */
+        std::chrono::milliseconds m_MaxHold;
+
+        /*!
+         * @brief report pressing backspace, used to erase typed characters
+         */
+        KeyReport m_Backspace;
+
+        /*!
+         * @brief the last report queued for the host, i.e. what the host thinks is held down
+         */
+        KeyReport m_LastReport;
+
+        /*!
+         * @brief reports for the output device, in runs which are written together
+         */
+        struct Burst
+        {
+            /*!
+             * @brief the reports, in order
+             */
+            std::vector<KeyReport> reports;
+
+            /*!
+             * @brief the number of reports in each run, and whether they are bulk reports
+             */
+            std::vector<std::pair<std::size_t, bool>> runs;
+
+            bool empty() const { return reports.empty(); }
+
+            void clear()
+            {
+                reports.clear();
+                runs.clear();
+            }
+        };
+
+        /*!
+         * @brief reports queued for the output device
+         */
+        Burst m_Burst;
+
+        /*!
+         * @brief reports being written to the output device, guarded by m_OutputMutex
+         */
+        Burst m_Writing;
+
+        /*!
+         * @brief the time each captured key was pressed, indexed by key code
+         */
+        std::array<TimePoint, KeyMask::SIZE> m_PressTimes;
+
+        /*!
+         * @brief the press times of a committed chord's keys, handed to m_Timing, kept to save
+         * allocating for every chord
+         */
+        std::array<TimePoint, KeyMask::SIZE> m_ChordPresses;
+
+        /*!
+         * @brief all modifier keys, so they can be masked out of m_Captured
+         */
+        KeyMask m_Modifiers;
 
         /*!
          * @brief key table describing character representations
@@ -101,14 +329,41 @@ namespace hemiola
          */
         std::vector<unsigned int> m_ModSequence;
 
-        // Time threshold for outputting the key codes
-        std::chrono::milliseconds m_TimeThreshold;
+        /*!
+         * @brief time after the last key press at which a chord is output even if keys are still
+         * held, per chord size
+         */
+        ChordTiming m_Timing;
+
+        /*!
+         * @brief the time of the most recent key press
+         */
+        TimePoint m_LastPress;
+
+        /*!
+         * @brief true if the last keys captured didn't make up a word, i.e. they were typed
+         */
+        bool m_LastTyped;
+
+        /*!
+         * @brief time from the kernel seeing a key to it being processed
+         */
+        LatencyStats m_InputDelay;
 
         // Thread that runs the timer loop
         std::thread m_TimerThread;
 
         // Mutex to protect access to the shared data structures
         std::mutex m_Mutex;
+
+        // Mutex which keeps bursts written from different threads from interleaving
+        std::mutex m_OutputMutex;
+
+        // Wakes the timer thread when a key is captured or the timer should stop
+        std::condition_variable m_Wakeup;
+
+        // Flag telling the timer thread to exit
+        bool m_Stop;
     };
 
 }
@@ -21,6 +21,10 @@
 
 #include "HID.h"
 
+#include <linux/input-event-codes.h>
+
+#include <bitset>
+#include <cstddef>
 #include <string>
 
 // forward declaration
@@ -34,6 +38,11 @@ namespace hemiola
     class InputHID : public HID
     {
     public:
+        /*!
+         * @brief one bit per key code, set if the key is held down
+         */
+        using KeyState = std::bitset<KEY_CNT>;
+
         InputHID()
             : HID()
         {}
@@ -55,5 +64,50 @@ namespace hemiola
          * @assumption device has been opened for reading
          */
         virtual void read ( input_event& event ) = 0;
+
+        /*!
+         * @brief read as many events as are available, up to count, waiting for at least one
+         * @param events where to save the events
+         * @param count the most events to read
+         * @return the number of events read, at least one unless the device was woken for
+         * something else, e.g. a keyboard being plugged in
+         * @throw IoException if we are unable to read from device
+         * @assumption device has been opened for reading
+         * @note by default this reads a single event
+         */
+        virtual std::size_t read ( input_event* events, const std::size_t count )
+        {
+            if ( count == 0 ) {
+                return 0;
+            }
+            read ( *events );
+            return 1;
+        }
+
+        /*!
+         * @brief ask the device which keys are held down right now, e.g. to resynchronise after
+         *        events have been dropped
+         * @return the keys which are held down
+         * @throw IoException if we are unable to query the device
+         * @assumption device has been opened for reading
+         * @note by default no keys are held
+         */
+        virtual KeyState keyState() const { return KeyState {}; }
+
+        /*!
+         * @brief whether the timestamps of the events read are CLOCK_MONOTONIC, and so can be
+         *        compared with std::chrono::steady_clock
+         * @return true if the event timestamps are monotonic
+         * @note by default they are not, evdev stamping events with CLOCK_REALTIME unless asked
+         */
+        virtual bool monotonicTime() const { return false; }
+
+        /*!
+         * @brief wake a read which is waiting for events, which then returns without any, this
+         *        may be called from any thread
+         * @throw IoException if the read can't be woken
+         * @note by default nothing is done, for devices whose reads don't wait
+         */
+        virtual void wake() {}
     };
 }  // namespace hemiola
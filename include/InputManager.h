@@ -0,0 +1,280 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "InputHID.h"
+#include "KeyboardFinder.h"
+#include "LatencyStats.h"
+
+#include <linux/input.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hemiola
+{
+    /*!
+     * @brief input device which merges the events of every keyboard plugged in, attaching and
+     *        detaching keyboards as they are plugged in and unplugged
+     * @note fd is an epoll descriptor watching the keyboards and the device directory, so this
+     * can be watched like any other device
+     */
+    class InputManager : public InputHID
+    {
+    public:
+        /*!
+         * @brief creates the device used to read from a keyboard
+         */
+        using DeviceFactory = std::function<std::shared_ptr<InputHID> ( const std::string& )>;
+
+        /*!
+         * @brief CTOR
+         * @param devRoot the directory holding the event devices
+         * @param probe used to ask each device whether it is a keyboard
+         * @param factory creates the device for each keyboard found, by default a Keyboard
+         */
+        explicit InputManager ( const std::string& devRoot = "/dev/input/",
+                                std::shared_ptr<DeviceProbe> probe
+                                = std::make_shared<DeviceProbe>(),
+                                DeviceFactory factory = nullptr );
+        InputManager ( const InputManager& ) = delete;
+        InputManager ( InputManager&& ) = delete;
+        InputManager& operator= ( const InputManager& ) = delete;
+        InputManager& operator= ( InputManager&& ) = delete;
+        ~InputManager();
+
+        /*!
+         * @brief start watching the device directory and attach every keyboard already there
+         * @throw IoException if the device directory can't be watched
+         * @note no keyboard being plugged in isn't an error, one is attached once plugged in
+         */
+        void open() override;
+
+        /*!
+         * @brief detach every keyboard and stop watching the device directory
+         */
+        void close() override;
+
+        /*!
+         * @copydoc InputHID::read(input_event&)
+         */
+        void read ( input_event& event ) override;
+
+        /*!
+         * @brief read the events of every keyboard which has some waiting, in the order they
+         *        happened, waiting if there are none
+         * @param events where to save the events
+         * @param count the most events to read
+         * @return the number of events read, which is 0 if only keyboards were plugged in or
+         * unplugged, or the read was woken
+         * @throw IoException if the keyboards can't be waited for
+         * @note events are handed out a whole frame at a time, frames from different keyboards
+         * being ordered by the time of their SYN_REPORT. Keys held on a keyboard which is
+         * unplugged are released
+         */
+        std::size_t read ( input_event* events, const std::size_t count ) override;
+
+        /*!
+         * @brief ask every keyboard which keys are held down right now
+         * @return the keys held down on any of the keyboards
+         * @throw IoException if we are unable to query a keyboard
+         */
+        KeyState keyState() const override;
+
+        /*!
+         * @brief events are always stamped with CLOCK_MONOTONIC, those of keyboards which can't
+         *        be switched to it being stamped when they are read
+         * @return true
+         */
+        bool monotonicTime() const override { return true; }
+
+        /*!
+         * @copydoc InputHID::wake
+         */
+        void wake() override;
+
+        /*!
+         * @brief number of keyboards attached
+         */
+        std::size_t keyboards() const { return m_Devices.size(); }
+
+        /*!
+         * @brief time from a keyboard being unplugged to a keyboard being attached again
+         * @return statistics for every time a keyboard was plugged back in
+         */
+        const LatencyStats& recovery() const { return m_Recovery; }
+
+    private:
+        /*!
+         * @brief a keyboard being read from
+         */
+        struct Device
+        {
+            /*!
+             * @brief the event device the keyboard was found at
+             */
+            std::string path;
+
+            /*!
+             * @brief the device events are read from
+             */
+            std::shared_ptr<InputHID> hid;
+
+            /*!
+             * @brief the events read and not yet handed out, complete frames followed by the
+             * start of the next one
+             */
+            std::vector<input_event> pending;
+
+            /*!
+             * @brief the keys held on this keyboard, according to the events read from it
+             */
+            KeyState held {};
+
+            /*!
+             * @brief flag indicating if the keyboard has been unplugged
+             */
+            bool lost { false };
+        };
+
+        /*!
+         * @brief a complete frame in a device's pending events
+         */
+        struct Frame
+        {
+            /*!
+             * @brief the keyboard the frame was read from
+             */
+            Device* device;
+
+            /*!
+             * @brief the frame's first event and one past its SYN_REPORT in device's pending
+             */
+            std::size_t begin;
+            std::size_t end;
+
+            /*!
+             * @brief the frame's SYN_REPORT, whose time orders the frame
+             */
+            const input_event& report() const { return device->pending [end - 1]; }
+        };
+
+        /*!
+         * @brief wait for the keyboards or the device directory and handle whatever is ready
+         * @post m_Ready holds the complete frames read, in order
+         */
+        void poll();
+
+        /*!
+         * @brief read the events waiting on a keyboard in to its pending events
+         * @param device the keyboard to read from
+         * @post device is marked as lost if it couldn't be read from
+         */
+        void readDevice ( Device& device );
+
+        /*!
+         * @brief attach and detach keyboards for the changes in the device directory
+         */
+        void readNotifications();
+
+        /*!
+         * @brief open a keyboard and start watching it, if it is one and isn't attached already
+         * @param path the device to attach
+         */
+        void attach ( const std::string& path );
+
+        /*!
+         * @brief hand out the release of every key only held on a lost keyboard, and forget it
+         * @param fd the file descriptor the keyboard is registered with
+         */
+        void detach ( const int fd );
+
+        /*!
+         * @brief move the complete frames of every keyboard in to m_Ready, oldest first
+         */
+        void mergeFrames();
+
+        /*!
+         * @brief finds the keyboards in the device directory
+         */
+        KeyboardFinder m_Finder;
+
+        /*!
+         * @brief creates the device used to read from a keyboard
+         */
+        DeviceFactory m_Factory;
+
+        /*!
+         * @brief inotify descriptor watching the device directory
+         */
+        int m_NotifyId;
+
+        /*!
+         * @brief eventfd which is readable while m_Ready holds events not yet handed out
+         */
+        int m_LeftoverId;
+
+        /*!
+         * @brief flag indicating if m_LeftoverId is readable
+         */
+        bool m_Leftover;
+
+        /*!
+         * @brief eventfd written to wake a read waiting for keyboards
+         */
+        int m_WakeId;
+
+        /*!
+         * @brief the keyboards attached, by file descriptor
+         */
+        std::map<int, Device> m_Devices;
+
+        /*!
+         * @brief the complete frames of the last poll, ready to be handed out
+         */
+        std::vector<input_event> m_Ready;
+
+        /*!
+         * @brief the first event of m_Ready not yet handed out
+         */
+        std::size_t m_ReadyAt;
+
+        /*!
+         * @brief the frames being merged, kept to save allocating on every poll
+         */
+        std::vector<Frame> m_Frames;
+
+        /*!
+         * @brief when a keyboard was last unplugged, until a keyboard is attached again
+         */
+        std::optional<std::chrono::steady_clock::time_point> m_LostAt;
+
+        /*!
+         * @brief time from a keyboard being unplugged to a keyboard being attached again
+         */
+        LatencyStats m_Recovery;
+    };
+}  // namespace hemiola
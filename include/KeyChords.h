@@ -19,32 +19,22 @@
 */
 #pragma once
 
+#include "ChordImage.h"
+#include "KeyMask.h"
+#include "KeyReport.h"
 #include "KeyTable.h"
 
 #include <linux/input.h>
 
+#include <cstddef>
 #include <memory>
-#include <set>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 namespace hemiola
 {
-    struct Hasher
-    {
-        inline std::size_t operator() ( const std::set<unsigned int>& a ) const
-        {
-            std::size_t h = 0;
-
-            for ( auto e : a ) {
-                h ^= std::hash<int> {}( e ) + 0x9e3779b9 + ( h << 6 ) + ( h >> 2 );
-            }
-            return h;
-        }
-    };
-
-    using ChordMap = std::unordered_map<std::set<unsigned int>, std::string, Hasher>;
-
     /*!
      * @brief class which contains the map of chords to words
      */
@@ -57,35 +47,117 @@ namespace hemiola
         /*!
          * @brief Given a chord return the corresponding string. If the chord doesn't exist return
          * the original chord.
-         * @param
+         * @param chord The chord to translate
          */
         std::string getWord ( const std::string& chord ) const;
 
+        /*!
+         * @brief Translate the given set of keys to a word
+         * @param chord The keys making up the chord
+         * @return The word corresponding to the chord, or an empty string if there is none
+         */
+        std::string_view getWord ( const KeyMask& chord ) const;
+
+        /*!
+         * @brief The word a chord produces
+         * @param chord An entry returned by resolve
+         */
+        std::string_view word ( const Chord& chord ) const { return m_Image->word ( chord ); }
+
+        /*!
+         * @brief Look up the dictionary entry for the given set of keys
+         * @param chord The keys making up the chord
+         * @return The compiled entry for the chord, or nullptr if there is none
+         */
+        const Chord* resolve ( const KeyMask& chord ) const;
+
+        /*!
+         * @brief Count the chords which can still be reached by pressing more keys
+         * @param keys The keys pressed so far
+         * @return The number of chords containing all of keys, including keys itself
+         */
+        std::size_t reachable ( const KeyMask& keys ) const;
+
+        /*!
+         * @brief Look up the dictionary entry for a set of keys which no further key press could
+         *        turn into a different chord
+         * @param keys The keys pressed so far
+         * @return The compiled entry, or nullptr if keys isn't a chord or is part of a larger one
+         */
+        const Chord* resolveUnique ( const KeyMask& keys ) const;
+
+        /*!
+         * @brief The reports which type out a chord's word
+         * @param chord An entry returned by resolve
+         * @return The reports to send to the output device, in order
+         */
+        ReportSpan reports ( const Chord& chord ) const { return m_Image->reports ( chord ); }
+
         /*!
          * @brief Builds our chord map from user input
          */
         void buildMap();
 
         /*!
-         * @brief Translate the given chord to a word
-         * @param chord The chord to translate
-         * @return The word corresponding to the chord
+         * @brief Builds our chord map from the given settings file
+         * @param config location of the settings file
+         * @param strict throw on a chord which clashes with another instead of leaving it out
+         * @throw DictionaryException if strict and two chords clash
+         */
+        void buildMap ( const std::string& config, const bool strict = false );
+
+        /*!
+         * @brief Use the dictionary compiled in to hemiola if it was built with one, then the
+         *        dictionary compiled by hemiola-dictc if there is one which is up to date, and
+         *        otherwise build the chord map from the settings file
          */
-        std::string getWord ( const std::string& chord );
+        void load();
+
+        /*!
+         * @brief Map a dictionary compiled by hemiola-dictc, which is used in place
+         * @param dictionary location of the compiled dictionary
+         * @throw IoException if the dictionary can't be mapped
+         * @throw DictionaryException if the dictionary isn't valid
+         */
+        void loadImage ( const std::string& dictionary );
+
+        /*!
+         * @brief Write the chord map out as a compiled dictionary, for loadImage
+         * @param dictionary where to write the compiled dictionary
+         * @throw IoException if the dictionary can't be written
+         */
+        void saveImage ( const std::string& dictionary ) const;
+
+        /*!
+         * @brief The compiled chord map, e.g. for compiling it in to hemiola
+         */
+        const ChordImage& image() const { return *m_Image; }
 
     private:
         /*!
-         * @brief split chord into individual characters
-         * @param chord the chord to split into characters
-         * @return a set representing the chord
+         * @brief split chord into individual keys, e.g. "bg + past"
+         * @param chord the chord to split into keys
+         * @return the keys making up the chord, or an empty mask if the chord is invalid
+         */
+        KeyMask parseChord ( std::string chord ) const;
+
+        /*!
+         * @brief compile a word into the reports needed to type it
+         * @param word the word to compile
+         * @return the reports, or nothing if the word can't be typed
+         */
+        std::optional<std::vector<KeyReport>> compileWord ( const std::string& word ) const;
+
+        /*!
+         * the compiled chord map, built from the settings file or mapped from a compiled
+         * dictionary
          */
-        std::set<unsigned int> parseChord ( std::string chord );
+        std::unique_ptr<ChordImage> m_Image;
 
         /*!
-         * map of chords to words
-         * @TODO: read this in from a yaml file
+         * true if m_Image is the dictionary compiled in to hemiola, which has a perfect hash
          */
-        ChordMap m_ChordMap;
+        bool m_Builtin;
 
         /*!
          * Key representing the special input dup
@@ -0,0 +1,56 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include <chrono>
+
+namespace hemiola
+{
+    /*!
+     * @brief a single key edge as seen by the chord detector
+     */
+    struct KeyEvent
+    {
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        /*!
+         * @brief the scan code of the key, or KEY_RESERVED if the event carried no key
+         */
+        unsigned int code { 0 };
+        /*!
+         * @brief true if the key went down and false if it was released
+         */
+        bool pressed { false };
+        /*!
+         * @brief when the kernel saw the key, on the steady clock, or the epoch if unknown in
+         * which case the time it is processed is used instead
+         */
+        TimePoint time {};
+    };
+
+    /*!
+     * @brief comparison operator for KeyEvent
+     * @note the time is ignored, it only says when the key was seen not which key it was
+     */
+    inline bool operator== ( const KeyEvent& lhs, const KeyEvent& rhs )
+    {
+        return lhs.code == rhs.code && lhs.pressed == rhs.pressed;
+    }
+}
@@ -0,0 +1,202 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace hemiola
+{
+    /*!
+     * @brief fixed size set of key codes stored as a bitmask
+     * @note only key codes below 256 fit, so only they can be chorded; evdev keyboard keys go on
+     * past the BTN_* codes up to KEY_MAX, e.g. KEY_OK and KEY_FN, and Hemiola::updateChord
+     * ignores those
+     */
+    struct KeyMask
+    {
+        /*!
+         * @brief number of key codes the mask can hold
+         */
+        static constexpr std::size_t SIZE = 256;
+
+        using Word = uint64_t;
+        static constexpr std::size_t WORD_BITS = 64;
+        using Words = std::array<Word, SIZE / WORD_BITS>;
+
+        /*!
+         * @brief one bit per key code, bit i of words[j] is key code j * 64 + i
+         */
+        Words words {};
+
+        /*!
+         * @brief check if a key code can be stored in the mask
+         */
+        static constexpr bool inRange ( const unsigned int key ) { return key < SIZE; }
+
+        /*!
+         * @brief add a key to the mask
+         * @assumption key is in range
+         */
+        void set ( const unsigned int key )
+        {
+            words [key / WORD_BITS] |= Word { 1 } << ( key % WORD_BITS );
+        }
+
+        /*!
+         * @brief remove a key from the mask
+         * @assumption key is in range
+         */
+        void reset ( const unsigned int key )
+        {
+            words [key / WORD_BITS] &= ~( Word { 1 } << ( key % WORD_BITS ) );
+        }
+
+        /*!
+         * @brief check if a key is in the mask
+         */
+        bool test ( const unsigned int key ) const
+        {
+            return inRange ( key ) && ( words [key / WORD_BITS] >> ( key % WORD_BITS ) ) & 1;
+        }
+
+        /*!
+         * @brief number of times key occurs in the mask, i.e. 0 or 1
+         */
+        std::size_t count ( const unsigned int key ) const { return test ( key ) ? 1 : 0; }
+
+        /*!
+         * @brief number of keys in the mask
+         */
+        std::size_t size() const
+        {
+            std::size_t total = 0;
+            for ( const auto word : words ) {
+                total += static_cast<std::size_t> ( __builtin_popcountll ( word ) );
+            }
+            return total;
+        }
+
+        /*!
+         * @brief check if there are no keys in the mask
+         */
+        bool empty() const
+        {
+            Word any = 0;
+            for ( const auto word : words ) {
+                any |= word;
+            }
+            return any == 0;
+        }
+
+        /*!
+         * @brief remove all keys from the mask
+         */
+        void clear() { words = Words {}; }
+
+        /*!
+         * @brief check if every key in other is also in this mask
+         */
+        bool contains ( const KeyMask& other ) const
+        {
+            for ( std::size_t i = 0; i < words.size(); ++i ) {
+                if ( ( other.words [i] & ~words [i] ) != 0 ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /*!
+         * @brief call func with each key code in the mask, in ascending order
+         */
+        template <typename Func>
+        void forEach ( Func&& func ) const
+        {
+            for ( std::size_t i = 0; i < words.size(); ++i ) {
+                for ( auto word = words [i]; word != 0; word &= word - 1 ) {
+                    func ( static_cast<unsigned int> ( i * WORD_BITS
+                                                       + __builtin_ctzll ( word ) ) );
+                }
+            }
+        }
+
+        KeyMask& operator|= ( const KeyMask& other )
+        {
+            for ( std::size_t i = 0; i < words.size(); ++i ) {
+                words [i] |= other.words [i];
+            }
+            return *this;
+        }
+
+        KeyMask& operator&= ( const KeyMask& other )
+        {
+            for ( std::size_t i = 0; i < words.size(); ++i ) {
+                words [i] &= other.words [i];
+            }
+            return *this;
+        }
+
+        /*!
+         * @brief remove every key in other from this mask
+         */
+        KeyMask& operator-= ( const KeyMask& other )
+        {
+            for ( std::size_t i = 0; i < words.size(); ++i ) {
+                words [i] &= ~other.words [i];
+            }
+            return *this;
+        }
+    };
+
+    inline KeyMask operator| ( KeyMask lhs, const KeyMask& rhs ) { return lhs |= rhs; }
+
+    inline KeyMask operator& ( KeyMask lhs, const KeyMask& rhs ) { return lhs &= rhs; }
+
+    inline KeyMask operator- ( KeyMask lhs, const KeyMask& rhs ) { return lhs -= rhs; }
+
+    /*!
+     * @brief comparison operator for KeyMask
+     */
+    inline bool operator== ( const KeyMask& lhs, const KeyMask& rhs )
+    {
+        return lhs.words == rhs.words;
+    }
+
+    inline bool operator!= ( const KeyMask& lhs, const KeyMask& rhs ) { return !( lhs == rhs ); }
+
+    /*!
+     * @brief hash for using a KeyMask as the key of an unordered container
+     */
+    struct KeyMaskHasher
+    {
+        inline std::size_t operator() ( const KeyMask& mask ) const
+        {
+            std::size_t h = 0;
+
+            for ( const auto word : mask.words ) {
+                h ^= std::hash<KeyMask::Word> {}( word ) + 0x9e3779b9 + ( h << 6 ) + ( h >> 2 );
+            }
+            return h;
+        }
+    };
+}  // namespace hemiola
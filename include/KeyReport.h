@@ -22,12 +22,22 @@
 #include <linux/input.h>
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace hemiola
 {
     using KeyArray = std::array<uint8_t, 6>;
+
+    /*!
+     * @brief one bit per usage id, packed in to 64 bit words
+     */
+    using KeyBits = std::array<uint64_t, 4>;
+
     /*!
-     * @brief struct describing the current key press
+     * @brief struct describing the current key press. The first 8 bytes are laid out exactly as
+     *        the boot protocol report sent to the host, keys pressed once its six slots are full
+     *        are kept in a bitmap after it, for n-key rollover
      */
     struct KeyReport
     {
@@ -36,62 +46,145 @@ namespace hemiola
          *                      bit 4 is R CTRL, bit 5 is R SHIFT, bit 6 is R ALT, and bit 7 is R
          *                      GUI).
          */
-        uint8_t modifiers;
+        uint8_t modifiers { 0x00 };
+        /*!
+         * @brief reserved byte of the boot protocol report, always 0
+         */
+        uint8_t reserved { 0x00 };
         /*!
          * @brief list of keys pressed with modifier (6 allowed)
          */
         KeyArray keys {};
+        /*!
+         * @brief keys pressed while all of the boot protocol slots were taken, by usage id
+         */
+        KeyBits rollover {};
 
         /*!
          * @brief Add key to the key report
-         * @returns true if the key was added to the report and false otherwise
+         * @returns true if the key didn't fit in the boot protocol slots, in which case it is
+         * added to rollover instead and false otherwise
          */
         bool setKey ( const uint8_t scanHex )
         {
             // add current key press to the list of key presses, and don't overwrite
-            // TODO: handle KEY_ERR_OVF
-            bool overflow = true;
+            uint8_t* slot = nullptr;
             for ( auto& code : keys ) {
                 // key was already added to report
                 if ( code == scanHex ) {
-                    overflow = false;
-                    break;
-                } else if ( code == 0x00 ) {
-                    code = scanHex;
-                    overflow = false;
-                    break;
+                    return false;
+                } else if ( code == 0x00 && slot == nullptr ) {
+                    slot = &code;
                 }
             }
-            return overflow;
+
+            if ( slot == nullptr || testBit ( rollover, scanHex ) ) {
+                // the boot protocol would report KEY_ERR_OVF, instead the key is kept for n-key
+                // rollover and left out of the boot slots until one is freed
+                rollover [scanHex / 64] |= bit ( scanHex );
+                return true;
+            }
+
+            *slot = scanHex;
+            return false;
         }
 
         /*!
          * @brief If a scancode exists in the key report remove it
+         * @post if the key had a boot protocol slot, the lowest key in rollover takes its place,
+         * so keys in rollover show up to a boot protocol host once there is room for them
          */
         void unsetKey ( const uint8_t scanHex )
         {
-            // find the key and set to 0
+            // find the key and replace it with a key from rollover, or 0
             for ( auto& code : keys ) {
                 if ( code == scanHex ) {
-                    code = 0x00;
-                    break;
+                    code = takeRollover();
+                    return;
                 }
             }
+            rollover [scanHex / 64] &= ~bit ( scanHex );
         }
 
         void setModifier ( const uint8_t scanHex ) { modifiers |= scanHex; }
 
         void unsetModifier ( const uint8_t scanHex ) { modifiers &= ~scanHex; }
+
+        /*!
+         * @brief all keys held in the report, boot protocol slots and rollover alike, by usage id
+         * @return one bit for each held key
+         */
+        KeyBits held() const
+        {
+            auto bits = rollover;
+            for ( const auto code : keys ) {
+                if ( code != 0x00 ) {
+                    bits [code / 64] |= bit ( code );
+                }
+            }
+            return bits;
+        }
+
+        /*!
+         * @brief check if any key is held in rollover, i.e. the boot protocol report is missing
+         *        keys
+         */
+        bool overflowed() const
+        {
+            return ( rollover [0] | rollover [1] | rollover [2] | rollover [3] ) != 0;
+        }
+
+        /*!
+         * @brief remove the lowest key from rollover
+         * @return the key, or 0x00 if rollover is empty
+         */
+        uint8_t takeRollover()
+        {
+            for ( std::size_t i = 0; i < rollover.size(); ++i ) {
+                if ( rollover [i] != 0 ) {
+                    const auto usage
+                        = static_cast<uint8_t> ( i * 64 + __builtin_ctzll ( rollover [i] ) );
+                    rollover [i] &= rollover [i] - 1;
+                    return usage;
+                }
+            }
+            return 0x00;
+        }
+
+        static constexpr uint64_t bit ( const uint8_t usage )
+        {
+            return uint64_t { 1 } << ( usage % 64 );
+        }
+
+        static constexpr bool testBit ( const KeyBits& bits, const uint8_t usage )
+        {
+            return ( bits [usage / 64] & bit ( usage ) ) != 0;
+        }
+    };
+
+    static_assert ( offsetof ( KeyReport, rollover ) == 8,
+                    "The start of KeyReport must match the boot protocol report" );
+
+    /*!
+     * @brief view over a contiguous sequence of reports
+     */
+    struct ReportSpan
+    {
+        const KeyReport* first { nullptr };
+        std::size_t count { 0 };
+
+        const KeyReport* begin() const { return first; }
+        const KeyReport* end() const { return first + count; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
     };
 
     /*!
-     * @brief comparison operator for KeyReport
+     * @brief comparison operator for KeyReport, reports are equal if they hold the same keys and
+     *        modifiers, whichever boot protocol slots the keys are in
      */
     inline bool operator== ( const KeyReport& lhs, const KeyReport& rhs )
     {
-        return lhs.modifiers == rhs.modifiers
-               && ( lhs.keys [0] == rhs.keys [0] && lhs.keys [1] == rhs.keys [1]
-                    && lhs.keys [2] == rhs.keys [2] && lhs.keys [3] == rhs.keys [3]
-                    && lhs.keys [4] == rhs.keys [4] && lhs.keys [5] == rhs.keys [5] );
+        return lhs.modifiers == rhs.modifiers && lhs.held() == rhs.held();
     }
 }
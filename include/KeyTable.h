@@ -23,23 +23,104 @@
 
 #include <linux/input.h>
 
-#include <cstring>
-#include <functional>
-#include <iostream>
-#include <optional>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
-#include <vector>
+#include <string_view>
 
 namespace hemiola
 {
+    /*!
+     * @brief everything known about a single key code, see KeyTable
+     */
+    struct KeyInfo
+    {
+        /*!
+         * @brief flag bits
+         */
+        static constexpr uint8_t VALID = 0x01;
+        static constexpr uint8_t CHARACTER = 0x02;
+        static constexpr uint8_t MODIFIER = 0x04;
+
+        /*!
+         * @brief string representation of a character key or the name of a modifier key
+         */
+        std::string_view name {};
+
+        /*!
+         * @brief hex value of the key in a key report
+         */
+        uint8_t hex { 0x00 };
+
+        /*!
+         * @brief hex value of the key in the modifier byte of a key report
+         */
+        uint8_t modifierHex { 0x00 };
+
+        /*!
+         * @brief combination of VALID, CHARACTER and MODIFIER
+         */
+        uint8_t flags { 0x00 };
+    };
+
+    /*!
+     * @brief a key code and a value associated with it, used for listing the key table
+     */
+    template <typename Value>
+    struct KeyEntry
+    {
+        unsigned int key;
+        Value value;
+    };
+
+    /*!
+     * @brief merge the lists of key properties into a single table indexed by key code
+     * @note this is evaluated at compile time, so lookups are plain array loads
+     */
+    template <std::size_t Size,
+              std::size_t Chars,
+              std::size_t Mods,
+              std::size_t Hexes,
+              std::size_t ModifierHexes>
+    constexpr std::array<KeyInfo, Size> buildKeyTable (
+        const KeyEntry<std::string_view> ( &charKeys ) [Chars],
+        const KeyEntry<std::string_view> ( &modKeys ) [Mods],
+        const KeyEntry<uint8_t> ( &hexValues ) [Hexes],
+        const KeyEntry<uint8_t> ( &modifierHex ) [ModifierHexes] )
+    {
+        std::array<KeyInfo, Size> table {};
+        for ( const auto& [key, name] : charKeys ) {
+            table [key].name = name;
+            table [key].flags |= KeyInfo::CHARACTER;
+        }
+        for ( const auto& [key, name] : modKeys ) {
+            table [key].name = name;
+            table [key].flags |= KeyInfo::MODIFIER | KeyInfo::VALID;
+        }
+        for ( const auto& [key, hex] : hexValues ) {
+            table [key].hex = hex;
+            table [key].flags |= KeyInfo::VALID;
+        }
+        for ( const auto& [key, hex] : modifierHex ) {
+            table [key].modifierHex = hex;
+        }
+
+        return table;
+    }
+
     /*!
      * @brief class which contains the system key map
      */
     class KeyTable
     {
     public:
-        KeyTable();
+        /*!
+         * @brief number of key codes in the table, key codes outside of it are never valid
+         */
+        static constexpr std::size_t SIZE = 256;
+
+        KeyTable() = default;
         ~KeyTable() = default;
 
         /*!
@@ -72,7 +153,7 @@ namespace hemiola
          */
         inline bool isModifier ( const uint8_t code ) const
         {
-            return m_ModifierHex.count ( code ) > 0;
+            return hasFlag ( code, KeyInfo::MODIFIER );
         }
 
         /*!
@@ -82,7 +163,7 @@ namespace hemiola
          */
         inline bool isScanModifier ( const unsigned int key ) const
         {
-            return m_ModKeys.count ( key ) > 0;
+            return hasFlag ( key, KeyInfo::MODIFIER );
         };
 
         /*!
@@ -92,7 +173,7 @@ namespace hemiola
          */
         inline bool isCharKey ( const unsigned int key ) const
         {
-            return m_CharKeys.count ( key ) > 0;
+            return hasFlag ( key, KeyInfo::CHARACTER );
         }
 
         /*!
@@ -102,7 +183,7 @@ namespace hemiola
          */
         inline bool isKeyValid ( const unsigned int key ) const
         {
-            return m_HexValues.count ( key ) > 0 || isScanModifier ( key );
+            return hasFlag ( key, KeyInfo::VALID );
         }
 
         /*!
@@ -110,7 +191,7 @@ namespace hemiola
          * @param code the scan code from key press
          * @return string representing the scan code or empty string if not a valid key code
          */
-        std::string charKeys ( const unsigned int key ) const;
+        std::string_view charKeys ( const unsigned int key ) const;
 
         /*!
          * @brief get the modifier key string corresponding to a scan code
@@ -118,7 +199,7 @@ namespace hemiola
          * @return string representing the the modifier for scan code or empty string if not a valid
          * key code
          */
-        std::string modKeys ( const unsigned int key ) const;
+        std::string_view modKeys ( const unsigned int key ) const;
 
         /*!
          * @brief get the beginning modifier string corresponding to a scan code
@@ -145,19 +226,20 @@ namespace hemiola
 
     private:
         /*!
-         * @brief check if the key is a modifier matching the predicate
-         * @param key The key code to check if it is a modifier matching the predicate
-         * @param predicate The predicate for checking the modifier
-         * @return true if the modifier matches the predicate
+         * @brief check if a key code is in the table and has all of the given flags
+         * @param key the key code to check
+         * @param flag the flags to check for
+         * @return true if key has the flags
          */
-        bool isTypeModifier (
-            const std::string& key,
-            std::function<std::string ( const unsigned int )> typePredicate ) const;
+        static inline bool hasFlag ( const unsigned int key, const uint8_t flag )
+        {
+            return key < SIZE && ( TABLE [key].flags & flag ) == flag;
+        }
 
         /*!
          * @brief Character Keys
          */
-        std::unordered_map<unsigned int, std::string> m_CharKeys = {
+        static constexpr KeyEntry<std::string_view> CHAR_KEYS [] = {
             { KEY_A, "a" },  // Keyboard a and A
             { KEY_B, "b" },  // Keyboard b and B
             { KEY_C, "c" },  // Keyboard c and C
@@ -217,16 +299,11 @@ namespace hemiola
             { KEY_DELETE, "<DELETE/>" },  // Keyboard Delete Forward
         };
 
-        /*!
-         * Reverse lookup for the character map;
-         */
-        std::unordered_map<std::string, unsigned int> m_KeyCodeMap;
-
         /*!
          * @brief Function Keys these will have slightly different representation since
          *        they have a begin and an end, e.g. <LCTRL></LCTRL>
          */
-        std::unordered_map<unsigned int, std::string> m_ModKeys {
+        static constexpr KeyEntry<std::string_view> MOD_KEYS [] = {
             { KEY_LEFTCTRL, "LCTRL" },     // Keyboard Left Control
             { KEY_LEFTSHIFT, "LSHIFT" },   // Keyboard Left Shift
             { KEY_LEFTALT, "LALT" },       // Keyboard Left Alt
@@ -241,7 +318,7 @@ namespace hemiola
          * @brief map of key code to hex value for key reports
          */
         // TODO: update this from key map
-        std::unordered_map<unsigned int, uint8_t> m_HexValues = {
+        static constexpr KeyEntry<uint8_t> HEX_VALUES [] = {
             /**
              * Scan codes - last N slots in the HID report (usually 6).
              * 0x00 if no key pressed.
@@ -498,7 +575,7 @@ namespace hemiola
             { KEY_RIGHTMETA, 0xE7 },  // Keyboard Right GUI
         };
 
-        const std::unordered_map<unsigned int, uint8_t> m_ModifierHex = {
+        static constexpr KeyEntry<uint8_t> MODIFIER_HEX [] = {
             { KEY_LEFTCTRL, 0x01 },    // Keyboard Left Control
             { KEY_LEFTSHIFT, 0x02 },   // Keyboard Left Shift
             { KEY_LEFTALT, 0x04 },     // Keyboard Left Alt
@@ -509,10 +586,14 @@ namespace hemiola
             { KEY_RIGHTMETA, 0x80 },   // Keyboard Right GUI
         };
 
-        unsigned short N_KEYS_DEFINED = 106;  // sum of all 'c' and 'f' chars in charOrFunc[]
+        /*!
+         * @brief all of the above merged into a table indexed by key code
+         */
+        static constexpr std::array<KeyInfo, SIZE> TABLE
+            = buildKeyTable<SIZE> ( CHAR_KEYS, MOD_KEYS, HEX_VALUES, MODIFIER_HEX );
 
-        const std::string m_BeginModifierFmt = "<{}>";
-        const std::string m_EndModifierFmt = "</{}>";
+        static constexpr std::string_view BEGIN_MODIFIER_FMT = "<{}>";
+        static constexpr std::string_view END_MODIFIER_FMT = "</{}>";
     };
 
 }  // namespace hemiola
@@ -21,6 +21,7 @@
 
 #include "InputHID.h"
 
+#include <cstddef>
 #include <string>
 
 // forward declaration
@@ -35,6 +36,11 @@ namespace hemiola
     {
     public:
         Keyboard();
+        /*!
+         * @brief CTOR for a known device, instead of looking the keyboard up when opened
+         * @param device the event device of the keyboard, e.g. /dev/input/event0
+         */
+        explicit Keyboard ( const std::string& device );
         Keyboard ( const Keyboard& ) = delete;
         Keyboard ( Keyboard&& ) = delete;
         Keyboard& operator= ( const Keyboard& ) = delete;
@@ -54,11 +60,32 @@ namespace hemiola
          */
         void read ( input_event& event ) override;
 
+        /*!
+         * @copydoc InputHID::read(input_event*,const std::size_t)
+         */
+        std::size_t read ( input_event* events, const std::size_t count ) override;
+
+        /*!
+         * @copydoc InputHID::keyState
+         */
+        KeyState keyState() const override;
+
+        /*!
+         * @copydoc InputHID::monotonicTime
+         */
+        bool monotonicTime() const override { return m_Monotonic; }
+
     private:
         /*!
          * @brief look up keyboard
          * @throw KeyboardException if a keyboard cannot be found
          */
         std::string getKeyboard();
+
+        /*!
+         * @brief flag indicating if the device was switched to stamping events with
+         * CLOCK_MONOTONIC
+         */
+        bool m_Monotonic;
     };
 }  // namespace hemiola
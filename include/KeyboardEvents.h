@@ -20,14 +20,19 @@
 #pragma once
 
 #include "InputHID.h"
+#include "KeyEvent.h"
 #include "KeyReport.h"
 #include "KeyTable.h"
 
 #include <linux/input.h>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <exception>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace hemiola
 {
@@ -45,38 +50,132 @@ namespace hemiola
         ~KeyboardEvents() = default;
 
         /*!
-         * @brief begin capturing keys
+         * @brief begin capturing keys, until stop is called or an error arises
          * @param onEvent function which will handle any key capture events
          * @param onError function which will handle any errors that arise
+         * @note events are grouped in to frames ending with SYN_REPORT, and onEvent is called
+         * once for each key pressed or released in the frame, with the report after the whole
+         * frame has been applied. Frames without a key press or release, e.g. repeats, produce
+         * no calls at all
          */
-        void capture ( std::function<void ( KeyReport, unsigned int )> onEvent,
+        void capture ( std::function<void ( KeyReport, KeyEvent )> onEvent,
                        std::function<void ( std::exception_ptr )> onError );
 
+        /*!
+         * @brief make capture return, this may be called from any thread
+         * @throw IoException if the input device can't be woken
+         */
+        void stop();
+
+        /*!
+         * @brief read and process every event that is waiting, up to BATCH_SIZE, e.g. when the
+         *        device is reported as readable
+         * @param onEvent function which will handle the key capture events, called as each frame
+         * is completed
+         * @throw IoException if no events were able to be read from the keyboard
+         */
+        void captureEvents ( const std::function<void ( KeyReport, KeyEvent )>& onEvent );
+
+        /*!
+         * @brief number of times the kernel dropped events because they weren't read fast enough
+         * @return the number of SYN_DROPPED events seen
+         */
+        std::size_t drops() const { return m_Drops; }
+
+        /*!
+         * @brief most events read from the keyboard at once
+         */
+        static constexpr std::size_t BATCH_SIZE = 64;
+
     private:
         /*!
-         * @brief read key event
-         * @param event the key event captured from the keyboard
-         * @return true if key event an event was captured succesfully
+         * @brief read the events waiting on the keyboard in to m_Events
+         * @return the number of events read
          * @throw IOError if an event was not able to be read from the keyboard
          */
-        bool getEvent ( input_event& event ) const;
+        std::size_t getEvents();
+
+        /*!
+         * @brief add an event to the current frame, or finish the frame
+         * @param event the event to process
+         * @param onEvent function which will handle the key capture events
+         */
+        void processEvent ( const input_event& event,
+                            const std::function<void ( KeyReport, KeyEvent )>& onEvent );
 
         /*!
          * @brief function that translates key press into KeyState
          * @param event the key event to process
-         * @post m_KeyReport and m_KeyRep will contain data corresponding to event
+         * @post m_KeyReport and m_KeyEvent will contain data corresponding to event
          */
         void updateKeyState ( const input_event& event );
 
+        /*!
+         * @brief when the kernel saw an event
+         * @param event the event
+         * @return the event's timestamp on the steady clock, or the epoch if the device doesn't
+         * stamp events with CLOCK_MONOTONIC
+         */
+        KeyEvent::TimePoint keyTime ( const input_event& event ) const;
+
+        /*!
+         * @brief rebuild the report from the keys the device says are held, after events have
+         *        been dropped
+         * @param time when the dropped events ended, which the missed keys are stamped with
+         * @post m_Frame holds a release for every key which was missed being released, and a
+         * press for every key which was missed being pressed
+         */
+        void resync ( const KeyEvent::TimePoint time );
+
+        /*!
+         * @brief hand the keys pressed and released in the current frame to onEvent
+         * @param onEvent function which will handle the key capture events
+         * @post m_Frame is empty, and the key state is saved as the start of the next frame
+         */
+        void endFrame ( const std::function<void ( KeyReport, KeyEvent )>& onEvent );
+
         /*!
          * @brief the current key press
          */
         KeyReport m_KeyReport;
 
         /*!
-         * @brief current key press/release
+         * @brief the key that was pressed or released by the current event
+         */
+        KeyEvent m_KeyEvent;
+
+        /*!
+         * @brief the keys whose presses made it in to m_KeyReport
+         */
+        InputHID::KeyState m_Held;
+
+        /*!
+         * @brief m_KeyReport and m_Held as they were at the start of the current frame, which
+         * are gone back to if the rest of the frame is dropped
+         */
+        KeyReport m_FrameReport;
+        InputHID::KeyState m_FrameHeld;
+
+        /*!
+         * @brief true from a SYN_DROPPED until the SYN_REPORT after it, during which events are
+         * incomplete and ignored
+         */
+        bool m_Dropping;
+
+        /*!
+         * @brief number of SYN_DROPPED events seen
+         */
+        std::size_t m_Drops;
+
+        /*!
+         * @brief the keys pressed and released since the last SYN_REPORT
          */
-        unsigned int m_KeyRep;
+        std::vector<KeyEvent> m_Frame;
+
+        /*!
+         * @brief the events most recently read from the keyboard
+         */
+        std::array<input_event, BATCH_SIZE> m_Events;
 
         /*
          * @brief object containing the key map
@@ -87,5 +186,10 @@ namespace hemiola
          * @brief input device we are capturing keys from
          */
         std::shared_ptr<InputHID> m_InputHID;
+
+        /*!
+         * @brief flag indicating if capture should return
+         */
+        std::atomic<bool> m_Stop;
     };
 }  // namespace hemiola
@@ -0,0 +1,164 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "InputHID.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hemiola
+{
+    /*!
+     * @brief what an input device says about itself
+     */
+    struct DeviceInfo
+    {
+        /*!
+         * @brief the device's name, e.g. "Logitech USB Keyboard"
+         */
+        std::string name;
+
+        /*!
+         * @brief the keys the device is able to send
+         */
+        InputHID::KeyState keys;
+
+        /*!
+         * @brief the bus the device is on, e.g. BUS_USB, or BUS_VIRTUAL for one made with uinput
+         */
+        uint16_t bus { 0 };
+
+        /*!
+         * @brief the device's vendor id, 0 if it has none
+         */
+        uint16_t vendor { 0 };
+    };
+
+    /*!
+     * @brief asks an input device about itself
+     */
+    class DeviceProbe
+    {
+    public:
+        DeviceProbe() = default;
+        DeviceProbe ( const DeviceProbe& ) = delete;
+        DeviceProbe ( DeviceProbe&& ) = delete;
+        DeviceProbe& operator= ( const DeviceProbe& ) = delete;
+        DeviceProbe& operator= ( DeviceProbe&& ) = delete;
+        virtual ~DeviceProbe() = default;
+
+        /*!
+         * @brief query a device with EVIOCGNAME, EVIOCGBIT and EVIOCGID
+         * @param path the device to query
+         * @return what the device says about itself, or nothing if it can't be opened or doesn't
+         * send key events
+         */
+        virtual std::optional<DeviceInfo> probe ( const std::string& path ) const;
+    };
+
+    /*!
+     * @brief finds the keyboard among the event devices in a directory
+     */
+    class KeyboardFinder
+    {
+    public:
+        /*!
+         * @brief CTOR
+         * @param devRoot the directory holding the event devices
+         * @param probe used to ask each device about itself
+         */
+        explicit KeyboardFinder ( const std::string& devRoot = "/dev/input/",
+                                  std::shared_ptr<DeviceProbe> probe
+                                  = std::make_shared<DeviceProbe>() );
+        KeyboardFinder ( const KeyboardFinder& ) = delete;
+        KeyboardFinder ( KeyboardFinder&& ) = delete;
+        KeyboardFinder& operator= ( const KeyboardFinder& ) = delete;
+        KeyboardFinder& operator= ( KeyboardFinder&& ) = delete;
+        ~KeyboardFinder() = default;
+
+        /*!
+         * @brief find the device which looks most like a keyboard
+         * @return the path of the keyboard
+         * @throw KeyboardException if no device looks like a keyboard
+         */
+        std::string find() const;
+
+        /*!
+         * @brief find every device which looks like a keyboard, e.g. both halves of a split
+         *        keyboard
+         * @return the paths of the keyboards, lowest numbered first, which may be empty
+         * @throw KeyboardException if the devices can't be listed
+         */
+        std::vector<std::string> findAll() const;
+
+        /*!
+         * @brief whether a single device looks like a keyboard, e.g. when it has been plugged in
+         * @param path the device to check
+         * @return true if the device scores above 0
+         */
+        bool isKeyboard ( const std::string& path ) const;
+
+        /*!
+         * @brief whether a file in the device directory is an event device
+         * @param file the name of the file, without the directory
+         * @return true if the file is named like an event device, e.g. event3
+         */
+        static bool isEventDevice ( const std::string& file );
+
+        /*!
+         * @brief the directory holding the event devices
+         * @return the directory, ending with a /
+         */
+        const std::string& devRoot() const { return m_DevRoot; }
+
+        /*!
+         * @brief score how much a device looks like a keyboard
+         * @param info what the device says about itself
+         * @return 0 if it isn't a keyboard at all, otherwise higher for a device which is
+         * plugged in from a vendor rather than virtual, which has keyboard in its name and for each
+         * key it can send
+         */
+        static std::size_t score ( const DeviceInfo& info );
+
+    private:
+        /*!
+         * @brief score every event device
+         * @return the path and score of each device which looks like a keyboard, lowest numbered
+         * first
+         * @throw KeyboardException if the devices can't be listed
+         */
+        std::vector<std::pair<std::string, std::size_t>> scan() const;
+
+        /*!
+         * @brief the directory holding the event devices
+         */
+        std::string m_DevRoot;
+
+        /*!
+         * @brief used to ask each device about itself
+         */
+        std::shared_ptr<DeviceProbe> m_Probe;
+    };
+}  // namespace hemiola
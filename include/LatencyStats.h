@@ -0,0 +1,77 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+namespace hemiola
+{
+    /*!
+     * @brief running statistics for the time taken to get a key press out to the host
+     */
+    struct LatencyStats
+    {
+        using Duration = std::chrono::nanoseconds;
+
+        /*!
+         * @brief number of samples recorded
+         */
+        std::size_t count { 0 };
+
+        /*!
+         * @brief sum of all samples
+         */
+        Duration total { Duration::zero() };
+
+        /*!
+         * @brief smallest sample recorded
+         */
+        Duration min { Duration::max() };
+
+        /*!
+         * @brief largest sample recorded
+         */
+        Duration max { Duration::zero() };
+
+        /*!
+         * @brief record a single sample
+         * @param sample the latency to record
+         */
+        void add ( const Duration sample )
+        {
+            ++count;
+            total += sample;
+            min = std::min ( min, sample );
+            max = std::max ( max, sample );
+        }
+
+        /*!
+         * @brief average of all recorded samples
+         * @return the mean latency or zero if nothing has been recorded
+         */
+        Duration mean() const
+        {
+            return count == 0 ? Duration::zero()
+                              : total / static_cast<Duration::rep> ( count );
+        }
+    };
+}  // namespace hemiola
@@ -21,12 +21,14 @@
 
 #include "HID.h"
 
+#include <chrono>
 #include <string>
 
 namespace hemiola
 {
     // forward declarations
     struct KeyReport;
+    struct ReportSpan;
 
     /*!
      * @brief simple class handling communication with input device
@@ -34,6 +36,8 @@ namespace hemiola
     class OutputHID : public HID
     {
     public:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
         /*!
          * @copydoc HID::HID(const std::string&)
          */
@@ -56,5 +60,47 @@ namespace hemiola
          * @assumption device has been opened for writing
          */
         virtual void write ( const KeyReport& report ) const = 0;
+
+        /*!
+         * @brief write a report generated by hemiola, e.g. part of a chord's word, which may be
+         *        held back in favour of reports passed on live from the keyboard
+         * @param report byte data for the keypress to send to HID output
+         * @throw IoException if we are unable to write to device
+         * @assumption device has been opened for writing
+         * @note by default this is the same as write
+         */
+        virtual void writeBulk ( const KeyReport& report ) const { write ( report ); }
+
+        /*!
+         * @brief write a run of reports, e.g. a whole chord's word at once
+         * @param reports the reports to write, in order
+         * @param bulk true to write them with writeBulk and false to write them with write
+         * @param since the time the kernel saw the input event the reports result from, which
+         * their latency is measured from
+         * @throw IoException if we are unable to write to device
+         * @assumption device has been opened for writing
+         * @note by default each report is written in turn and since is ignored
+         */
+        virtual void
+        writeReports ( const ReportSpan& reports, const bool bulk, const TimePoint since ) const;
+
+        /*!
+         * @brief write a report if the device can take it without blocking
+         * @param report byte data for the keypress to send to HID output
+         * @return true if the report was written and false if the device isn't ready for it,
+         * e.g. because the host has stopped polling
+         * @throw IoException if we are unable to write to device
+         * @assumption device has been opened for writing
+         * @note by default this writes the report and returns true
+         */
+        virtual bool tryWrite ( const KeyReport& report ) const;
+
+        /*!
+         * @brief wait for the device to be ready for another report
+         * @param timeout the longest to wait
+         * @return true if the device is ready and false if the timeout ran out first
+         * @note devices without a file descriptor are always ready
+         */
+        virtual bool waitWritable ( const std::chrono::milliseconds timeout ) const;
     };
 }  // namespace hemiola
@@ -0,0 +1,154 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyMask.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace hemiola
+{
+    /*!
+     * @brief a slot of a perfect hash table of chords
+     */
+    struct PerfectSlot
+    {
+        /*!
+         * @brief entry of a free slot
+         */
+        static constexpr uint32_t FREE = std::numeric_limits<uint32_t>::max();
+
+        KeyMask::Words chord {};
+
+        /*!
+         * @brief what the chord maps to, e.g. its slot in a compiled dictionary, or FREE
+         */
+        uint32_t entry { FREE };
+
+        /*!
+         * @brief check if the slot holds the given chord
+         */
+        constexpr bool holds ( const KeyMask::Words& other ) const
+        {
+            for ( std::size_t i = 0; i < chord.size(); ++i ) {
+                if ( chord [i] != other [i] ) {
+                    return false;
+                }
+            }
+            return entry != FREE;
+        }
+    };
+
+    /*!
+     * @brief hash which sends every chord of a fixed set to its own slot: chords are hashed to
+     *        buckets, and each bucket has a displacement moving its chords to slots no other
+     *        chord uses, so a lookup is a hash, one more multiply and a single compare
+     * @note everything used by a lookup is constexpr, so a table can be compiled in to hemiola
+     */
+    struct PerfectHash
+    {
+        static constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ull;
+
+        /*!
+         * @brief mixed in to every chord, varied until the chords can be placed
+         */
+        uint64_t seed;
+
+        /*!
+         * @brief 64 less the base two logarithm of the number of buckets
+         */
+        unsigned int bucketShift;
+
+        /*!
+         * @brief 64 less the base two logarithm of the number of slots
+         */
+        unsigned int slotShift;
+
+        /*!
+         * @brief hash of a chord, which picks its bucket
+         */
+        constexpr uint64_t fold ( const KeyMask::Words& chord ) const
+        {
+            uint64_t hash = seed;
+            for ( const auto word : chord ) {
+                hash = ( hash ^ word ) * MULTIPLIER;
+            }
+            return hash ^ ( hash >> 29 );
+        }
+
+        constexpr std::size_t bucket ( const uint64_t hash ) const
+        {
+            return static_cast<std::size_t> ( hash >> bucketShift );
+        }
+
+        constexpr std::size_t slot ( const uint64_t hash, const uint32_t displacement ) const
+        {
+            return static_cast<std::size_t> ( ( ( hash ^ displacement ) * MULTIPLIER )
+                                              >> slotShift );
+        }
+
+        /*!
+         * @brief the only slot a chord can be in
+         * @param chord the chord to look for
+         * @param displacements the displacement of each bucket
+         */
+        constexpr std::size_t find ( const KeyMask::Words& chord,
+                                     const uint32_t* displacements ) const
+        {
+            const auto hash = fold ( chord );
+            return slot ( hash, displacements [bucket ( hash )] );
+        }
+
+        /*!
+         * @brief number of slots in a table using this hash
+         */
+        constexpr std::size_t slotCount() const { return std::size_t { 1 } << ( 64 - slotShift ); }
+
+        /*!
+         * @brief number of buckets in a table using this hash
+         */
+        constexpr std::size_t bucketCount() const
+        {
+            return std::size_t { 1 } << ( 64 - bucketShift );
+        }
+    };
+
+    /*!
+     * @brief a perfect hash table of chords
+     */
+    struct PerfectTable
+    {
+        PerfectHash hash;
+        std::vector<uint32_t> displacements;
+        std::vector<PerfectSlot> slots;
+
+        /*!
+         * @brief find a perfect hash for a set of chords and place them in a table
+         * @param chords the chords and their entries
+         * @return the table, with at most half of its slots used
+         * @throw DictionaryException if a chord is empty or occurs more than once, or if no
+         * perfect hash could be found for the chords
+         */
+        static PerfectTable build ( const std::vector<PerfectSlot>& chords );
+    };
+}  // namespace hemiola
@@ -0,0 +1,143 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "BufferedOutputHID.h"
+#include "Hemiola.h"
+#include "InputHID.h"
+#include "KeyboardEvents.h"
+
+#include <memory>
+
+namespace hemiola
+{
+    /*!
+     * @brief single threaded event loop which multiplexes key capture, chord timing and HID
+     *        output with epoll, as an alternative to running each on its own thread
+     */
+    class Reactor
+    {
+    public:
+        /*!
+         * @brief CTOR
+         * @param events object translating input events into key reports
+         * @param input the device events are read from, used for its file descriptor
+         * @param hemiola the chord engine, which must write to output
+         * @param output the queue all reports are written through
+         * @throw IoException if the epoll, timer, pacing or wake up descriptors can't be created
+         */
+        Reactor ( std::shared_ptr<KeyboardEvents> events,
+                  std::shared_ptr<InputHID> input,
+                  std::shared_ptr<Hemiola> hemiola,
+                  std::shared_ptr<BufferedOutputHID> output );
+        Reactor ( const Reactor& ) = delete;
+        Reactor ( Reactor&& ) = delete;
+        Reactor& operator= ( const Reactor& ) = delete;
+        Reactor& operator= ( Reactor&& ) = delete;
+        ~Reactor();
+
+        /*!
+         * @brief run the event loop until stop is called
+         * @throw IoException if reading from or writing to a device fails
+         * @assumption the input and output devices have been opened
+         */
+        void run();
+
+        /*!
+         * @brief ask the event loop to exit, this may be called from any thread
+         */
+        void stop();
+
+        /*!
+         * @brief time from the input event each report results from to the report being written
+         * @return statistics for all reports written so far
+         */
+        const LatencyStats& latency() const { return m_Output->latency(); }
+
+    private:
+        /*!
+         * @brief register a file descriptor with our epoll instance
+         * @param fd the file descriptor to watch
+         * @param events the epoll events to watch for
+         */
+        void watch ( const int fd, const unsigned int events );
+
+        /*!
+         * @brief arm the timer for the next chord deadline, or disarm it if there is none
+         */
+        void armTimer();
+
+        /*!
+         * @brief only watch the output for being writable while there is something to write, and
+         *        the host has had time to poll for the last report
+         */
+        void updateOutputInterest();
+
+        /*!
+         * @brief object translating input events into key reports
+         */
+        std::shared_ptr<KeyboardEvents> m_Events;
+
+        /*!
+         * @brief the device events are read from
+         */
+        std::shared_ptr<InputHID> m_Input;
+
+        /*!
+         * @brief the chord engine
+         */
+        std::shared_ptr<Hemiola> m_Hemiola;
+
+        /*!
+         * @brief queue in front of the output device
+         */
+        std::shared_ptr<BufferedOutputHID> m_Output;
+
+        /*!
+         * @brief our epoll instance
+         */
+        int m_EpollId;
+
+        /*!
+         * @brief timer which fires when the next chord window closes
+         */
+        int m_TimerId;
+
+        /*!
+         * @brief eventfd used to wake the loop when stop is called
+         */
+        int m_StopId;
+
+        /*!
+         * @brief timer which fires when the next report may be written to the output
+         */
+        int m_PaceId;
+
+        /*!
+         * @brief flag indicating if the output is currently watched for being writable
+         */
+        bool m_WatchingOutput;
+
+        /*!
+         * @brief flag indicating if the pacing timer is armed
+         */
+        bool m_Pacing;
+    };
+}  // namespace hemiola
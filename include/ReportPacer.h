@@ -0,0 +1,132 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyReport.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace hemiola
+{
+    /*!
+     * @brief spaces reports out to the rate the host polls the device at, as reports written any
+     *        faster are merged or dropped, and measures how fast words are typed out
+     */
+    struct ReportPacer
+    {
+        using Duration = std::chrono::nanoseconds;
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        /*!
+         * @brief the host's polling interval, zero to write reports as fast as the device takes
+         * them
+         */
+        Duration interval { Duration::zero() };
+
+        /*!
+         * @brief the earliest time the next report may be written
+         */
+        TimePoint next {};
+
+        /*!
+         * @brief usage id of backspace, whose presses correct text rather than type a character
+         */
+        static constexpr uint8_t BACKSPACE = 0x2a;
+
+        /*!
+         * @brief number of characters typed out for chords, not counting backspaces
+         */
+        std::size_t characters { 0 };
+
+        /*!
+         * @brief time spent typing out chords, from the first report of a word to its last
+         */
+        Duration typing { Duration::zero() };
+
+        /*!
+         * @brief the time the word currently being typed out was started
+         */
+        TimePoint wordStart {};
+
+        /*!
+         * @brief true while a word is being typed out
+         */
+        bool inWord { false };
+
+        /*!
+         * @brief check if a report may be written yet
+         * @param now the current time
+         */
+        bool ready ( const TimePoint now ) const { return now >= next; }
+
+        /*!
+         * @brief record that a report has been written
+         * @param report the report which was written
+         * @param bulk true if the report is part of a chord's word
+         * @param wordDone true if no more of the word is waiting to be written
+         * @param now the time the report was written
+         */
+        void written ( const KeyReport& report,
+                       const bool bulk,
+                       const bool wordDone,
+                       const TimePoint now )
+        {
+            next = now + interval;
+            if ( !bulk ) {
+                return;
+            }
+
+            if ( !inWord ) {
+                inWord = true;
+                wordStart = now;
+            }
+            if ( typesCharacter ( report ) ) {
+                ++characters;
+            }
+            if ( wordDone ) {
+                typing += now - wordStart;
+                inWord = false;
+            }
+        }
+
+        /*!
+         * @brief check if a report types a character, rather than releasing keys or being a
+         *        backspace of the edit in front of a word
+         * @param report the report to check
+         */
+        static bool typesCharacter ( KeyReport report )
+        {
+            report.unsetKey ( BACKSPACE );
+            return !( report == KeyReport {} );
+        }
+
+        /*!
+         * @brief the rate words have been typed out at
+         * @return characters per second, or zero if nothing has been typed
+         */
+        double charactersPerSecond() const
+        {
+            const auto seconds = std::chrono::duration<double> ( typing ).count();
+            return seconds > 0 ? static_cast<double> ( characters ) / seconds : 0.0;
+        }
+    };
+}  // namespace hemiola
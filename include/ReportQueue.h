@@ -0,0 +1,133 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyReport.h"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+
+namespace hemiola
+{
+    /*!
+     * @brief bounded queue of reports waiting for the output device, which coalesces reports the
+     *        host no longer needs to see once it fills up, e.g. while the host isn't polling
+     *
+     * A report is only coalesced away if every key it presses is still held in the report after
+     * it, and no key held either side of it is released by it, so no key press is lost. If the
+     * queue is still full everything between the oldest and newest report is dropped, which
+     * leaves the host with the right keys held once it starts polling again.
+     */
+    class ReportQueue
+    {
+    public:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        /*!
+         * @brief a queued report
+         */
+        struct Entry
+        {
+            KeyReport report;
+
+            /*!
+             * @brief the time the report's latency is measured from, e.g. the time the kernel saw
+             * the input event it results from
+             */
+            TimePoint since;
+
+            /*!
+             * @brief true if the report is part of a chord's word rather than passed on live
+             */
+            bool bulk;
+        };
+
+        /*!
+         * @brief number of reports queued before they are coalesced
+         */
+        static constexpr std::size_t CAPACITY = 256;
+
+        /*!
+         * @brief CTOR
+         * @param capacity number of reports queued before they are coalesced, at least 2
+         */
+        explicit ReportQueue ( const std::size_t capacity = CAPACITY );
+
+        /*!
+         * @brief queue a report, coalescing queued reports if the queue is full
+         * @param report the report to queue
+         * @param since the time the report's latency is measured from
+         * @param bulk true if the report is part of a chord's word
+         * @post the oldest report is never coalesced away, so it may be in the middle of being
+         * written
+         */
+        void push ( const KeyReport& report, const TimePoint since, const bool bulk = false );
+
+        /*!
+         * @brief the oldest queued report
+         * @assumption the queue isn't empty
+         */
+        const Entry& front() const { return m_Entries.front(); }
+
+        /*!
+         * @brief remove the oldest queued report
+         * @assumption the queue isn't empty
+         */
+        void pop() { m_Entries.pop_front(); }
+
+        /*!
+         * @brief remove all queued reports
+         */
+        void clear() { m_Entries.clear(); }
+
+        bool empty() const { return m_Entries.empty(); }
+        std::size_t size() const { return m_Entries.size(); }
+
+        /*!
+         * @brief number of reports coalesced away without losing a key press
+         */
+        std::size_t coalesced() const { return m_Coalesced; }
+
+        /*!
+         * @brief number of reports dropped because the queue was full even after coalescing
+         */
+        std::size_t dropped() const { return m_Dropped; }
+
+    private:
+        /*!
+         * @brief remove reports which the host doesn't need to see
+         */
+        void coalesce();
+
+        /*!
+         * @brief queued reports along with the time their latency is measured from
+         */
+        std::deque<Entry> m_Entries;
+
+        /*!
+         * @brief number of reports queued before they are coalesced
+         */
+        std::size_t m_Capacity;
+
+        std::size_t m_Coalesced;
+        std::size_t m_Dropped;
+    };
+}  // namespace hemiola
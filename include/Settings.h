@@ -0,0 +1,89 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace hemiola
+{
+    /*!
+     * @brief run time settings read from the settings file
+     */
+    struct Settings
+    {
+        /*!
+         * @brief time after the last key press at which a chord is output even if keys are still
+         *        held down
+         */
+        std::chrono::milliseconds chordThreshold { 300 };
+
+        /*!
+         * @brief learn the threshold for each chord size from how the user types
+         */
+        bool adaptiveThreshold { false };
+
+        /*!
+         * @brief the smallest threshold the adaptive mode may choose
+         */
+        std::chrono::milliseconds minChordThreshold { 30 };
+
+        /*!
+         * @brief the largest threshold the adaptive mode may choose
+         */
+        std::chrono::milliseconds maxChordThreshold { 300 };
+
+        /*!
+         * @brief hold back keys which could be part of a chord until it is known whether they
+         *        are, instead of passing every key on straight away
+         */
+        bool holdBack { false };
+
+        /*!
+         * @brief the longest a key is held back before it is passed on anyway
+         */
+        std::chrono::milliseconds maxHold { 150 };
+
+        /*!
+         * @brief send n-key rollover reports instead of boot protocol reports, which requires the
+         *        gadget to have been set up with the n-key rollover descriptor
+         */
+        bool nkro { false };
+
+        /*!
+         * @brief the interval the host polls the keyboard at, reports are written no closer
+         *        together so that none are merged by the host, zero to not pace reports
+         */
+        std::chrono::microseconds reportInterval { 1000 };
+
+        /*!
+         * @brief read the settings from the default settings file
+         * @return the settings, with defaults for anything that isn't set
+         */
+        static Settings load();
+
+        /*!
+         * @brief read the settings from the given settings file
+         * @param config location of the settings file
+         * @return the settings, with defaults for anything that isn't set
+         */
+        static Settings load ( const std::string& config );
+    };
+}
@@ -0,0 +1,134 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace hemiola
+{
+    /*!
+     * @brief size of a cache line, used to keep the producer's and consumer's data apart
+     */
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    /*!
+     * @brief fixed size lock free queue for exactly one producer thread and one consumer thread
+     * @tparam Value the type of item queued, which should be small and trivially copyable
+     * @tparam Capacity the number of items the ring can hold, which must be a power of two
+     */
+    template<typename Value, std::size_t Capacity>
+    class SpscRing
+    {
+        static_assert ( Capacity > 0 && ( Capacity & ( Capacity - 1 ) ) == 0,
+                        "SpscRing capacity must be a power of two" );
+
+    public:
+        SpscRing() = default;
+        SpscRing ( const SpscRing& ) = delete;
+        SpscRing ( SpscRing&& ) = delete;
+        SpscRing& operator= ( const SpscRing& ) = delete;
+        SpscRing& operator= ( SpscRing&& ) = delete;
+        ~SpscRing() = default;
+
+        /*!
+         * @brief add an item to the ring, only to be called from the producer thread
+         * @param value the item to add
+         * @return true if the item was added and false if the ring is full
+         */
+        bool push ( const Value& value )
+        {
+            const auto tail = m_Tail.load ( std::memory_order_relaxed );
+            const auto depth = tail - m_Head.load ( std::memory_order_acquire );
+            if ( depth == Capacity ) {
+                return false;
+            }
+
+            m_Items [tail & ( Capacity - 1 )] = value;
+            m_Tail.store ( tail + 1, std::memory_order_release );
+
+            // only the producer writes the high water mark, so a relaxed update is enough
+            if ( depth + 1 > m_HighWater.load ( std::memory_order_relaxed ) ) {
+                m_HighWater.store ( depth + 1, std::memory_order_relaxed );
+            }
+
+            return true;
+        }
+
+        /*!
+         * @brief take the oldest item from the ring, only to be called from the consumer thread
+         * @param value set to the item taken
+         * @return true if an item was taken and false if the ring is empty
+         */
+        bool pop ( Value& value )
+        {
+            const auto head = m_Head.load ( std::memory_order_relaxed );
+            if ( head == m_Tail.load ( std::memory_order_acquire ) ) {
+                return false;
+            }
+
+            value = m_Items [head & ( Capacity - 1 )];
+            m_Head.store ( head + 1, std::memory_order_release );
+
+            return true;
+        }
+
+        /*!
+         * @brief the number of items currently in the ring
+         */
+        std::size_t depth() const
+        {
+            return m_Tail.load ( std::memory_order_acquire )
+                   - m_Head.load ( std::memory_order_acquire );
+        }
+
+        /*!
+         * @brief the most items that have been in the ring at once
+         */
+        std::size_t highWater() const { return m_HighWater.load ( std::memory_order_relaxed ); }
+
+        /*!
+         * @brief the number of items the ring can hold
+         */
+        static constexpr std::size_t capacity() { return Capacity; }
+
+    private:
+        /*!
+         * @brief the position of the next item to take, written by the consumer
+         */
+        alignas ( CACHE_LINE ) std::atomic<std::size_t> m_Head { 0 };
+
+        /*!
+         * @brief the position of the next item to add, written by the producer
+         */
+        alignas ( CACHE_LINE ) std::atomic<std::size_t> m_Tail { 0 };
+
+        /*!
+         * @brief the most items that have been in the ring at once, written by the producer
+         */
+        std::atomic<std::size_t> m_HighWater { 0 };
+
+        /*!
+         * @brief the items, on their own cache lines so neither index shares a line with them
+         */
+        alignas ( CACHE_LINE ) std::array<Value, Capacity> m_Items {};
+    };
+}
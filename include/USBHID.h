@@ -21,6 +21,10 @@
 
 #include "OutputHID.h"
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace hemiola
@@ -28,6 +32,23 @@ namespace hemiola
     // forward declarations
     struct KeyReport;
 
+    /*!
+     * @brief the layout of reports sent to the host, which must match the report descriptor the
+     *        gadget was set up with, see hid/hemiola_usb
+     */
+    enum class ReportFormat
+    {
+        /*!
+         * @brief 8 byte boot protocol report, holding at most six keys besides modifiers
+         */
+        BOOT,
+        /*!
+         * @brief modifiers, a reserved byte and a bitmap of every key usage, so any number of
+         * keys can be held
+         */
+        NKRO
+    };
+
     /*!
      * @brief simple class handling communication with input device
      */
@@ -37,7 +58,8 @@ namespace hemiola
         /*!
          * @copydoc HID::HID(const std::string&)
          */
-        explicit USBHID ( const std::string& device = "/dev/hidg0" );
+        explicit USBHID ( const std::string& device = "/dev/hidg0",
+                          const ReportFormat format = ReportFormat::BOOT );
         USBHID ( const USBHID& ) = delete;
         USBHID ( USBHID&& ) = delete;
         USBHID& operator= ( const USBHID& ) = delete;
@@ -45,11 +67,51 @@ namespace hemiola
         ~USBHID();
 
         /*!
-         * @brief write scan code to hid
+         * @brief write scan code to hid, waiting for the host to be ready for it
          * @param report byte data for the keypress to send to HID output
-         * @throw IoException if we are unable to write to device
+         * @throw IoException if we are unable to write to device, or the host hasn't been ready
+         * for a report within WRITE_TIMEOUT
          * @assumption device has been opened for writing
          */
         void write ( const KeyReport& report ) const override;
+
+        /*!
+         * @copydoc OutputHID::tryWrite
+         */
+        bool tryWrite ( const KeyReport& report ) const override;
+
+        /*!
+         * @brief the longest write waits for the host to be ready for a report
+         */
+        static constexpr std::chrono::milliseconds WRITE_TIMEOUT { 1000 };
+
+        /*!
+         * @brief length of a boot protocol report
+         */
+        static constexpr std::size_t BOOT_LENGTH = 8;
+
+        /*!
+         * @brief length of an n-key rollover report, modifiers, reserved and 256 key bits
+         */
+        static constexpr std::size_t NKRO_LENGTH = 34;
+
+        using ReportData = std::array<uint8_t, NKRO_LENGTH>;
+
+        /*!
+         * @brief lay out a report as it is sent to the host
+         * @param report the report to encode
+         * @param format the layout to use
+         * @param data where to put the encoded report
+         * @return the number of bytes of data used
+         */
+        static std::size_t encode ( const KeyReport& report,
+                                    const ReportFormat format,
+                                    ReportData& data );
+
+    private:
+        /*!
+         * @brief the layout of reports sent to the host
+         */
+        ReportFormat m_Format;
     };
 }  // namespace hemiola
@@ -0,0 +1,195 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "AsyncOutputHID.h"
+
+#include "Logger.h"
+
+#include <exception>
+#include <utility>
+
+using namespace hemiola;
+
+hemiola::AsyncOutputHID::AsyncOutputHID ( std::shared_ptr<OutputHID> device,
+                                          const std::chrono::nanoseconds interval )
+    : OutputHID ( "" )
+    , m_Device { std::move ( device ) }
+    , m_Pending {}
+    , m_Latency {}
+    , m_Pacer { interval }
+    , m_Error {}
+    , m_Stop { false }
+    , m_Writer {}
+{
+    m_Writer = std::thread ( [this] { writeLoop(); } );
+}
+
+hemiola::AsyncOutputHID::~AsyncOutputHID()
+{
+    try {
+        stop();
+    } catch ( const std::exception& exc ) {
+        LOG ( ERROR, "Output device failed while stopping: {}", exc.what() );
+    }
+}
+
+void hemiola::AsyncOutputHID::open()
+{
+    m_Device->open();
+}
+
+void hemiola::AsyncOutputHID::close()
+{
+    try {
+        stop();
+    } catch ( ... ) {
+        m_Device->close();
+        throw;
+    }
+    m_Device->close();
+}
+
+int hemiola::AsyncOutputHID::fd() const
+{
+    return m_Device->fd();
+}
+
+void hemiola::AsyncOutputHID::write ( const KeyReport& report ) const
+{
+    push ( ReportSpan { &report, 1 }, false, std::chrono::steady_clock::now() );
+}
+
+void hemiola::AsyncOutputHID::writeBulk ( const KeyReport& report ) const
+{
+    push ( ReportSpan { &report, 1 }, true, std::chrono::steady_clock::now() );
+}
+
+void hemiola::AsyncOutputHID::writeReports ( const ReportSpan& reports,
+                                             const bool bulk,
+                                             const TimePoint since ) const
+{
+    push ( reports, bulk, since );
+}
+
+void hemiola::AsyncOutputHID::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Stop = true;
+    }
+    m_Wakeup.notify_one();
+
+    if ( m_Writer.joinable() ) {
+        m_Writer.join();
+    }
+
+    // the writer's last error is passed on, as there is no later write to pass it on to
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    if ( m_Error != nullptr ) {
+        std::rethrow_exception ( std::exchange ( m_Error, nullptr ) );
+    }
+}
+
+LatencyStats hemiola::AsyncOutputHID::latency() const
+{
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    return m_Latency;
+}
+
+double hemiola::AsyncOutputHID::charactersPerSecond() const
+{
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    return m_Pacer.charactersPerSecond();
+}
+
+void hemiola::AsyncOutputHID::push ( const ReportSpan& reports,
+                                     const bool bulk,
+                                     const TimePoint since ) const
+{
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        if ( m_Error != nullptr ) {
+            std::rethrow_exception ( std::exchange ( m_Error, nullptr ) );
+        }
+        for ( const auto& report : reports ) {
+            m_Pending.push ( report, since, bulk );
+        }
+    }
+    m_Wakeup.notify_one();
+}
+
+void hemiola::AsyncOutputHID::writeLoop()
+{
+    std::unique_lock<std::mutex> lock ( m_Mutex );
+    while ( true ) {
+        m_Wakeup.wait ( lock, [this] { return m_Stop || !m_Pending.empty(); } );
+        if ( m_Pending.empty() ) {
+            break;  // only stop once everything queued has been written
+        }
+
+        // the host only sees one report per poll, so wait for the next one
+        if ( !m_Pacer.ready ( std::chrono::steady_clock::now() ) ) {
+            m_Wakeup.wait_until ( lock, m_Pacer.next );
+            continue;
+        }
+
+        // the front of the queue is never coalesced away, so it stays put while it is written
+        const auto entry = m_Pending.front();
+
+        // don't hold on to the lock while writing, so that queueing never waits on the device
+        lock.unlock();
+        bool written = false;
+        bool ready = true;
+        std::exception_ptr error;
+        try {
+            written = m_Device->tryWrite ( entry.report );
+            if ( !written ) {
+                // the host isn't polling, wait for it while reports carry on being queued
+                ready = m_Device->waitWritable ( WAIT_INTERVAL );
+            }
+        } catch ( ... ) {
+            LOG ( ERROR, "Unable to write report to output device" );
+            error = std::current_exception();
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        lock.lock();
+        if ( error != nullptr ) {
+            // the report is given up on, and the error passed on to whoever writes next
+            m_Pending.pop();
+            if ( m_Error == nullptr ) {
+                m_Error = error;
+            }
+            continue;
+        }
+
+        if ( !written ) {
+            if ( !ready && m_Stop ) {
+                LOG ( WARN, "Output device not ready, discarding {} reports", m_Pending.size() );
+                m_Pending.clear();
+            }
+            continue;
+        }
+
+        m_Pending.pop();
+        const bool wordDone = m_Pending.empty() || !m_Pending.front().bulk;
+        m_Pacer.written ( entry.report, entry.bulk, wordDone, now );
+        m_Latency.add ( now - entry.since );
+    }
+}
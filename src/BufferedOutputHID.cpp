@@ -0,0 +1,84 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "BufferedOutputHID.h"
+
+#include <cassert>
+#include <chrono>
+
+using namespace hemiola;
+
+hemiola::BufferedOutputHID::BufferedOutputHID ( std::shared_ptr<OutputHID> device,
+                                                const std::chrono::nanoseconds interval )
+    : OutputHID ( "" )
+    , m_Device { std::move ( device ) }
+    , m_Pending {}
+    , m_Latency {}
+    , m_Pacer { interval }
+{}
+
+void hemiola::BufferedOutputHID::open()
+{
+    m_Device->open();
+}
+
+void hemiola::BufferedOutputHID::close()
+{
+    m_Device->close();
+}
+
+int hemiola::BufferedOutputHID::fd() const
+{
+    return m_Device->fd();
+}
+
+void hemiola::BufferedOutputHID::write ( const KeyReport& report ) const
+{
+    m_Pending.push ( report, std::chrono::steady_clock::now() );
+}
+
+void hemiola::BufferedOutputHID::writeBulk ( const KeyReport& report ) const
+{
+    m_Pending.push ( report, std::chrono::steady_clock::now(), true );
+}
+
+void hemiola::BufferedOutputHID::writeReports ( const ReportSpan& reports,
+                                                const bool bulk,
+                                                const TimePoint since ) const
+{
+    for ( const auto& report : reports ) {
+        m_Pending.push ( report, since, bulk );
+    }
+}
+
+void hemiola::BufferedOutputHID::flush()
+{
+    assert ( pending() );
+
+    const auto entry = m_Pending.front();
+    // the device can refuse a report even when it polled as writable, so just try again later
+    if ( !m_Device->tryWrite ( entry.report ) ) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    m_Pending.pop();
+    m_Latency.add ( now - entry.since );
+    const bool wordDone = m_Pending.empty() || !m_Pending.front().bulk;
+    m_Pacer.written ( entry.report, entry.bulk, wordDone, now );
+}
@@ -0,0 +1,337 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "ChordImage.h"
+
+#include "Exceptions.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+using namespace hemiola;
+
+// the sections are copied to and used straight from the image, so must be plain bytes
+static_assert ( std::is_trivially_copyable_v<ChordImageHeader> );
+static_assert ( std::is_trivially_copyable_v<ChordSlot> );
+static_assert ( std::is_trivially_copyable_v<KeyReport> );
+static_assert ( sizeof ( ChordImageHeader ) % 8 == 0 );
+static_assert ( sizeof ( ChordSlot ) % 8 == 0 && sizeof ( KeyReport ) % 8 == 0 );
+
+const static std::array<char, 8> MAGIC { 'H', 'E', 'M', 'D', 'I', 'C', 'T', '\0' };
+
+static std::size_t align ( const std::size_t offset )
+{
+    return ( offset + 7 ) & ~std::size_t { 7 };
+}
+
+/*!
+ * @brief FNV-1a hash of a range of bytes
+ */
+static uint32_t checksum ( const uint8_t* first, const uint8_t* last )
+{
+    uint32_t hash = 2166136261u;
+    for ( ; first != last; ++first ) {
+        hash = ( hash ^ *first ) * 16777619u;
+    }
+    return hash;
+}
+
+/*!
+ * @brief whether count elements of the given size starting at offset fit in size bytes
+ */
+static bool fits ( const uint64_t offset,
+                   const uint64_t count,
+                   const uint64_t element,
+                   const uint64_t size )
+{
+    return offset % 8 == 0 && offset <= size && count * element <= size - offset;
+}
+
+hemiola::ChordImage::ChordImage ( std::vector<uint8_t> bytes )
+    : m_Bytes { std::move ( bytes ) }
+    , m_Mapped { nullptr }
+    , m_Data { m_Bytes.data() }
+    , m_Size { m_Bytes.size() }
+    , m_Header { nullptr }
+    , m_Slots { nullptr }
+    , m_Reports { nullptr }
+    , m_KeyStarts { nullptr }
+    , m_Index { nullptr }
+    , m_Arena { nullptr }
+{
+    attach();
+}
+
+hemiola::ChordImage::ChordImage ( const std::string& path )
+    : m_Bytes {}
+    , m_Mapped { nullptr }
+    , m_Data { nullptr }
+    , m_Size { 0 }
+    , m_Header { nullptr }
+    , m_Slots { nullptr }
+    , m_Reports { nullptr }
+    , m_KeyStarts { nullptr }
+    , m_Index { nullptr }
+    , m_Arena { nullptr }
+{
+    const auto fd = ::open ( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fd == -1 ) {
+        throw IoException ( "Unable to open chord dictionary " + path, errno );
+    }
+
+    struct stat info {};
+    if ( fstat ( fd, &info ) == -1 ) {
+        const auto error = errno;
+        ::close ( fd );
+        throw IoException ( "Unable to stat chord dictionary " + path, error );
+    }
+    if ( info.st_size < static_cast<off_t> ( sizeof ( ChordImageHeader ) ) ) {
+        ::close ( fd );
+        throw DictionaryException ( "Chord dictionary " + path + " is truncated" );
+    }
+
+    m_Size = static_cast<std::size_t> ( info.st_size );
+    m_Mapped = mmap ( nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    const auto error = errno;
+    ::close ( fd );
+    if ( m_Mapped == MAP_FAILED ) {
+        m_Mapped = nullptr;
+        throw IoException ( "Unable to map chord dictionary " + path, error );
+    }
+    m_Data = static_cast<const uint8_t*> ( m_Mapped );
+
+    try {
+        attach();
+    } catch ( ... ) {
+        munmap ( m_Mapped, m_Size );
+        throw;
+    }
+}
+
+hemiola::ChordImage::ChordImage ( const uint8_t* data, const std::size_t size )
+    : m_Bytes {}
+    , m_Mapped { nullptr }
+    , m_Data { data }
+    , m_Size { size }
+    , m_Header { nullptr }
+    , m_Slots { nullptr }
+    , m_Reports { nullptr }
+    , m_KeyStarts { nullptr }
+    , m_Index { nullptr }
+    , m_Arena { nullptr }
+{
+    attach();
+}
+
+hemiola::ChordImage::~ChordImage()
+{
+    if ( m_Mapped != nullptr ) {
+        munmap ( m_Mapped, m_Size );
+    }
+}
+
+std::vector<uint8_t> hemiola::ChordImage::compile ( const std::vector<ChordSource>& chords,
+                                                    const uint32_t dup,
+                                                    const uint32_t plural,
+                                                    const uint32_t past )
+{
+    // at most half full, so that probing for a chord which isn't there stops quickly
+    uint32_t slotCount = 8;
+    while ( slotCount < 2 * chords.size() ) {
+        slotCount *= 2;
+    }
+
+    std::vector<ChordSlot> slots ( slotCount, ChordSlot {} );
+    std::vector<KeyReport> reports;
+    std::string arena;
+    for ( const auto& source : chords ) {
+        const Chord entry { static_cast<uint32_t> ( arena.size() ),
+                            static_cast<uint32_t> ( source.word.size() ),
+                            static_cast<uint32_t> ( reports.size() ),
+                            static_cast<uint32_t> ( source.reports.size() ) };
+        arena += source.word;
+        reports.insert ( reports.end(), source.reports.begin(), source.reports.end() );
+
+        auto slot = hash ( source.chord ) & ( slotCount - 1 );
+        while ( !slots [slot].chord.empty() ) {
+            slot = ( slot + 1 ) & ( slotCount - 1 );
+        }
+        slots [slot] = ChordSlot { source.chord, entry };
+    }
+
+    // for each key, the slots of the chords containing it
+    std::vector<uint32_t> keyStarts ( KeyMask::SIZE + 1, 0 );
+    for ( const auto& slot : slots ) {
+        slot.chord.forEach ( [&keyStarts] ( const auto key ) { ++keyStarts [key + 1]; } );
+    }
+    for ( std::size_t key = 0; key < KeyMask::SIZE; ++key ) {
+        keyStarts [key + 1] += keyStarts [key];
+    }
+    std::vector<uint32_t> index ( keyStarts.back() );
+    auto next = keyStarts;
+    for ( uint32_t slot = 0; slot < slotCount; ++slot ) {
+        slots [slot].chord.forEach (
+            [&index, &next, slot] ( const auto key ) { index [next [key]++] = slot; } );
+    }
+
+    ChordImageHeader header {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.endian = ENDIAN;
+    header.dup = dup;
+    header.plural = plural;
+    header.past = past;
+    header.slotCount = slotCount;
+    header.chordCount = static_cast<uint32_t> ( chords.size() );
+    header.reportCount = static_cast<uint32_t> ( reports.size() );
+    header.indexCount = static_cast<uint32_t> ( index.size() );
+    header.arenaSize = static_cast<uint32_t> ( arena.size() );
+
+    std::size_t size = sizeof ( ChordImageHeader );
+    auto place = [&size] ( uint32_t& offset, const std::size_t bytes ) {
+        offset = static_cast<uint32_t> ( align ( size ) );
+        size = offset + bytes;
+    };
+    place ( header.slotsOffset, slots.size() * sizeof ( ChordSlot ) );
+    place ( header.reportsOffset, reports.size() * sizeof ( KeyReport ) );
+    place ( header.keyStartsOffset, keyStarts.size() * sizeof ( uint32_t ) );
+    place ( header.indexOffset, index.size() * sizeof ( uint32_t ) );
+    place ( header.arenaOffset, arena.size() );
+    header.size = static_cast<uint32_t> ( size );
+
+    std::vector<uint8_t> bytes ( size, 0 );
+    auto copy = [&bytes] ( const uint32_t offset, const auto& section ) {
+        std::memcpy (
+            bytes.data() + offset, section.data(), section.size() * sizeof ( section [0] ) );
+    };
+    copy ( header.slotsOffset, slots );
+    copy ( header.reportsOffset, reports );
+    copy ( header.keyStartsOffset, keyStarts );
+    copy ( header.indexOffset, index );
+    copy ( header.arenaOffset, arena );
+
+    header.checksum = checksum ( bytes.data() + sizeof ( ChordImageHeader ), bytes.data() + size );
+    std::memcpy ( bytes.data(), &header, sizeof ( header ) );
+    return bytes;
+}
+
+void hemiola::ChordImage::save ( const std::string& path ) const
+{
+    std::ofstream file ( path, std::ios::binary | std::ios::trunc );
+    file.write ( reinterpret_cast<const char*> ( m_Data ),
+                 static_cast<std::streamsize> ( m_Size ) );
+    file.close();
+    if ( !file ) {
+        throw IoException ( "Unable to write chord dictionary " + path, errno );
+    }
+}
+
+const Chord* hemiola::ChordImage::find ( const KeyMask& chord ) const
+{
+    // there is always a free slot, which ends the search for a chord which isn't there
+    const auto mask = m_Header->slotCount - 1;
+    for ( auto slot = hash ( chord ) & mask;; slot = ( slot + 1 ) & mask ) {
+        const auto& candidate = m_Slots [slot];
+        if ( candidate.chord.empty() ) {
+            return nullptr;
+        }
+        if ( candidate.chord == chord ) {
+            return &candidate.entry;
+        }
+    }
+}
+
+uint32_t hemiola::ChordImage::hash ( const KeyMask& chord )
+{
+    // std::hash differs between machines, e.g. with the size of size_t, so a fixed mix is used
+    uint64_t hash = 0;
+    for ( const auto word : chord.words ) {
+        hash ^= word;
+        hash = ( hash ^ ( hash >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+        hash = ( hash ^ ( hash >> 27 ) ) * 0x94d049bb133111ebull;
+        hash ^= hash >> 31;
+    }
+    return static_cast<uint32_t> ( hash );
+}
+
+void hemiola::ChordImage::attach()
+{
+    if ( m_Size < sizeof ( ChordImageHeader ) ) {
+        throw DictionaryException ( "Chord dictionary is truncated" );
+    }
+
+    m_Header = reinterpret_cast<const ChordImageHeader*> ( m_Data );
+    const auto& header = *m_Header;
+    if ( header.magic != MAGIC ) {
+        throw DictionaryException ( "Not a chord dictionary" );
+    }
+    if ( header.version != VERSION || header.endian != ENDIAN ) {
+        throw DictionaryException ( "Chord dictionary was compiled for a different version of "
+                                    "hemiola or machine, recompile it with hemiola-dictc" );
+    }
+    if ( header.size != m_Size
+         || header.checksum
+                != checksum ( m_Data + sizeof ( ChordImageHeader ), m_Data + m_Size ) ) {
+        throw DictionaryException ( "Chord dictionary is corrupt" );
+    }
+
+    const auto slotCount = header.slotCount;
+    if ( slotCount == 0 || ( slotCount & ( slotCount - 1 ) ) != 0
+         || header.chordCount >= slotCount
+         || !fits ( header.slotsOffset, slotCount, sizeof ( ChordSlot ), m_Size )
+         || !fits ( header.reportsOffset, header.reportCount, sizeof ( KeyReport ), m_Size )
+         || !fits ( header.keyStartsOffset, KeyMask::SIZE + 1, sizeof ( uint32_t ), m_Size )
+         || !fits ( header.indexOffset, header.indexCount, sizeof ( uint32_t ), m_Size )
+         || !fits ( header.arenaOffset, header.arenaSize, 1, m_Size ) ) {
+        throw DictionaryException ( "Chord dictionary sections are out of bounds" );
+    }
+
+    m_Slots = reinterpret_cast<const ChordSlot*> ( m_Data + header.slotsOffset );
+    m_Reports = reinterpret_cast<const KeyReport*> ( m_Data + header.reportsOffset );
+    m_KeyStarts = reinterpret_cast<const uint32_t*> ( m_Data + header.keyStartsOffset );
+    m_Index = reinterpret_cast<const uint32_t*> ( m_Data + header.indexOffset );
+    m_Arena = reinterpret_cast<const char*> ( m_Data + header.arenaOffset );
+
+    // the checksum catches damage, but not a dictionary written wrongly, which would be read out
+    // of bounds later
+    if ( m_KeyStarts [0] != 0 || m_KeyStarts [KeyMask::SIZE] != header.indexCount
+         || !std::is_sorted ( m_KeyStarts, m_KeyStarts + KeyMask::SIZE + 1 )
+         || std::any_of ( m_Index,
+                          m_Index + header.indexCount,
+                          [slotCount] ( const auto slot ) { return slot >= slotCount; } ) ) {
+        throw DictionaryException ( "Chord dictionary key index is invalid" );
+    }
+    const auto invalid
+        = std::any_of ( m_Slots, m_Slots + slotCount, [&header] ( const auto& slot ) {
+              const auto& entry = slot.entry;
+              return uint64_t { entry.word } + entry.wordLength > header.arenaSize
+                     || uint64_t { entry.firstReport } + entry.reportCount > header.reportCount;
+          } );
+    if ( invalid ) {
+        throw DictionaryException ( "Chord dictionary entries are out of bounds" );
+    }
+}
@@ -0,0 +1,101 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "ChordTiming.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace hemiola;
+
+// gaps recorded before the learned thresholds are trusted
+const static std::size_t MIN_SAMPLES { 20 };
+
+// weight of each new gap once MIN_SAMPLES have been recorded
+const static double WEIGHT { 0.05 };
+
+// the threshold covers this many standard deviations above the mean chord gap
+const static double DEVIATIONS { 3.0 };
+
+void hemiola::GapStats::add ( const Duration gap )
+{
+    const auto sample = std::chrono::duration<double, std::milli> ( gap ).count();
+
+    // start with a plain average, then slowly forget old gaps so the stats follow the user
+    ++count;
+    const auto weight
+        = count < MIN_SAMPLES ? 1.0 / static_cast<double> ( count ) : WEIGHT;
+    const auto delta = sample - mean;
+    mean += weight * delta;
+    variance = ( 1.0 - weight ) * ( variance + weight * delta * delta );
+}
+
+hemiola::ChordTiming::ChordTiming ( const Settings& settings )
+    : m_Settings { settings }
+    , m_ChordGaps {}
+    , m_TypingGaps {}
+    , m_Thresholds {}
+{
+    m_Thresholds.fill ( m_Settings.chordThreshold );
+}
+
+std::chrono::milliseconds hemiola::ChordTiming::threshold ( const std::size_t size ) const
+{
+    if ( !m_Settings.adaptiveThreshold ) {
+        return m_Settings.chordThreshold;
+    }
+
+    return m_Thresholds [std::clamp<std::size_t> ( size, 1, MAX_CHORD_SIZE ) - 1];
+}
+
+void hemiola::ChordTiming::addChord ( TimePoint* presses, const std::size_t count )
+{
+    std::sort ( presses, presses + count );
+    for ( std::size_t i = 1; i < count; ++i ) {
+        const auto index = std::min ( i, MAX_CHORD_SIZE ) - 1;
+        m_ChordGaps [index].add ( presses [i] - presses [i - 1] );
+        updateThreshold ( index );
+    }
+}
+
+void hemiola::ChordTiming::addTyping ( const GapStats::Duration gap )
+{
+    m_TypingGaps.add ( gap );
+    for ( std::size_t index = 0; index < MAX_CHORD_SIZE; ++index ) {
+        updateThreshold ( index );
+    }
+}
+
+void hemiola::ChordTiming::updateThreshold ( const std::size_t index )
+{
+    const auto& gaps = m_ChordGaps [index];
+    if ( gaps.count < MIN_SAMPLES ) {
+        return;
+    }
+
+    // wait long enough for nearly every chord, but no longer than it takes to type the next key
+    auto threshold = gaps.mean + DEVIATIONS * std::sqrt ( gaps.variance );
+    if ( m_TypingGaps.count >= MIN_SAMPLES ) {
+        threshold = std::min ( threshold, m_TypingGaps.mean );
+    }
+
+    const auto learned = std::chrono::milliseconds ( std::lround ( threshold ) );
+    m_Thresholds [index]
+        = std::clamp ( learned, m_Settings.minChordThreshold, m_Settings.maxChordThreshold );
+}
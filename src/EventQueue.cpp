@@ -0,0 +1,86 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "EventQueue.h"
+
+#include "Logger.h"
+
+#include <thread>
+
+using namespace hemiola;
+
+void hemiola::EventQueue::push ( const KeyReport& report, const KeyEvent& event )
+{
+    const QueuedEvent queued { report, event };
+    if ( !m_Ring.push ( queued ) ) {
+        // dropping the event could leave a key stuck down, so wait for the engine to catch up
+        if ( m_Overflows.fetch_add ( 1, std::memory_order_relaxed ) == 0 ) {
+            LOG ( WARN, "Event queue is full, the chord engine has fallen behind" );
+        }
+
+        while ( !m_Ring.push ( queued ) ) {
+            wake();
+            std::this_thread::yield();
+        }
+    }
+
+    // pairs with the fence in run, so that either the engine sees the event before it sleeps or
+    // we see that it is sleeping
+    std::atomic_thread_fence ( std::memory_order_seq_cst );
+    if ( m_Sleeping.load ( std::memory_order_relaxed ) ) {
+        wake();
+    }
+}
+
+void hemiola::EventQueue::run (
+    const std::function<void ( const KeyReport&, const KeyEvent& )>& onEvent )
+{
+    QueuedEvent queued {};
+    while ( true ) {
+        while ( m_Ring.pop ( queued ) ) {
+            onEvent ( queued.report, queued.event );
+        }
+
+        std::unique_lock<std::mutex> lock ( m_Mutex );
+        m_Sleeping.store ( true, std::memory_order_relaxed );
+        std::atomic_thread_fence ( std::memory_order_seq_cst );
+        m_Wakeup.wait ( lock, [this] {
+            return m_Ring.depth() > 0 || m_Stop.load ( std::memory_order_relaxed );
+        } );
+        m_Sleeping.store ( false, std::memory_order_relaxed );
+
+        if ( m_Stop.load ( std::memory_order_relaxed ) && m_Ring.depth() == 0 ) {
+            return;
+        }
+    }
+}
+
+void hemiola::EventQueue::stop()
+{
+    m_Stop.store ( true, std::memory_order_relaxed );
+    wake();
+}
+
+void hemiola::EventQueue::wake()
+{
+    // taking the lock means the engine is either still checking for events or already waiting,
+    // so the notification can't be lost
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    m_Wakeup.notify_one();
+}
@@ -24,56 +24,221 @@
 
 #include <fmt/ranges.h>
 
+#include <algorithm>
 #include <functional>
+#include <initializer_list>
+#include <utility>
 
 using namespace hemiola;
 
+// reports a single chord is expected to need, so the output buffers rarely have to grow
+const static std::size_t BURST_CAPACITY { 64 };
+
 hemiola::Hemiola::Hemiola ( std::shared_ptr<KeyTable> keyTable,
                             std::shared_ptr<KeyChords> keyChords,
-                            std::shared_ptr<OutputHID> output )
+                            std::shared_ptr<OutputHID> output,
+                            const Settings& settings )
     : m_Captured {}
+    , m_Held {}
+    , m_Typed {}
+    , m_HeldBack {}
+    , m_Withheld {}
+    , m_HoldStart {}
+    , m_HoldBack { settings.holdBack }
+    , m_MaxHold { settings.maxHold }
+    , m_Backspace {}
+    , m_LastReport {}
+    , m_Burst {}
+    , m_Writing {}
+    , m_PressTimes {}
+    , m_ChordPresses {}
+    , m_Modifiers {}
     , m_KeyTable { std::move ( keyTable ) }
     , m_KeyChords { std::move ( keyChords ) }
     , m_Output { output }
     , m_ModSequence {}
-    , m_TimeThreshold { 300 }
-{}
+    , m_Timing { settings }
+    , m_LastPress {}
+    , m_LastTyped { false }
+    , m_InputDelay {}
+    , m_Stop { false }
+{
+    for ( unsigned int key = 0; key < KeyMask::SIZE; ++key ) {
+        if ( m_KeyTable->isModifier ( key ) ) {
+            m_Modifiers.set ( key );
+        }
+    }
+
+    m_Backspace.setKey ( m_KeyTable->scanToHex ( KEY_BACKSPACE ) );
+    for ( auto* burst : { &m_Burst, &m_Writing } ) {
+        burst->reports.reserve ( BURST_CAPACITY );
+        burst->runs.reserve ( BURST_CAPACITY );
+    }
+}
 
 hemiola::Hemiola::~Hemiola()
 {
+    stop();
+}
+
+void hemiola::Hemiola::addEvent ( const KeyReport& report, const KeyEvent& event )
+{
+    std::unique_lock<std::mutex> lock ( m_Mutex );
+
+    // without hold back every report goes straight to the host and is corrected afterwards,
+    // unless the host has already seen it, e.g. for the second key of a frame
+    if ( !m_HoldBack ) {
+        const auto passthrough = withhold ( report );
+        if ( !( passthrough == m_LastReport ) ) {
+            queue ( passthrough );
+        }
+    }
+
+    if ( event.code != m_KeyTable->keyRelease() ) {
+        LOG ( DEBUG, "KEY: {} {}", event.code, event.pressed ? "pressed" : "released" );
+        updateChord ( event );
+    }
+
+    // otherwise the report is only sent once any decision it triggered has been output, and only
+    // if the host would see a change
+    if ( m_HoldBack ) {
+        const auto passthrough = withhold ( report );
+        if ( !( passthrough == m_LastReport ) ) {
+            queue ( passthrough );
+        }
+    }
+
+    writeBurst ( lock, event.time );
+}
+
+void hemiola::Hemiola::addKey ( const KeyEvent& event )
+{
+    LOG ( DEBUG, "KEY: {} {}", event.code, event.pressed ? "pressed" : "released" );
+    if ( event.code == m_KeyTable->keyRelease() ) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock ( m_Mutex );
+    updateChord ( event );
+
+    // the chord is output as soon as its last key is released, without waiting for the timer
+    writeBurst ( lock, event.time );
+}
+
+void hemiola::Hemiola::run()
+{
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Stop = false;
+    }
+
+    // Create a thread that runs the timer loop
+    m_TimerThread = std::thread ( [&] {
+        std::unique_lock<std::mutex> lock ( m_Mutex );
+        while ( !m_Stop ) {
+            // sleep until the chord times out, a new key arrives, or we are told to stop
+            const auto wakeup = nextDeadline();
+            if ( wakeup == TimePoint::max() ) {
+                m_Wakeup.wait ( lock );
+            } else {
+                m_Wakeup.wait_until ( lock, wakeup );
+            }
+
+            expireKeys ( std::chrono::steady_clock::now() );
+            if ( m_Burst.empty() ) {
+                continue;
+            }
+
+            writeBurst ( lock );
+            lock.lock();
+        }
+    } );
+}
+
+void hemiola::Hemiola::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Stop = true;
+    }
+    m_Wakeup.notify_all();
+
     if ( m_TimerThread.joinable() ) {
         m_TimerThread.join();
     }
 }
 
-void hemiola::Hemiola::addKey ( const unsigned int key )
+ChordTiming hemiola::Hemiola::timing()
 {
-    LOG ( DEBUG, "KEY: {}", key );
-    // key release
-    if ( key == m_KeyTable->keyRelease() ) {
-        return;
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    return m_Timing;
+}
+
+LatencyStats hemiola::Hemiola::inputDelay()
+{
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    return m_InputDelay;
+}
+
+hemiola::Hemiola::TimePoint hemiola::Hemiola::deadline()
+{
+    std::lock_guard<std::mutex> lock ( m_Mutex );
+    return nextDeadline();
+}
+
+void hemiola::Hemiola::poll ( const TimePoint now )
+{
+    std::unique_lock<std::mutex> lock ( m_Mutex );
+    expireKeys ( now );
+    writeBurst ( lock );
+}
+
+void hemiola::Hemiola::updateChord ( const KeyEvent& event )
+{
+    const auto key = event.code;
+
+    // keys are timed by when the kernel saw them, so how long they took to get here, e.g.
+    // waiting on the mutex, doesn't change how they are grouped in to chords
+    auto time = std::chrono::steady_clock::now();
+    if ( event.time != TimePoint {} ) {
+        m_InputDelay.add ( time - event.time );
+        time = event.time;
     }
 
-    auto notShiftOrAltGr = [this] ( const auto key ) -> bool {
+    auto notShiftOrAltGr = [] ( const auto key ) -> bool {
         return key != KEY_RIGHTALT && key != KEY_RIGHTSHIFT && key != KEY_LEFTSHIFT;
     };
 
-    // check if key is a modifier, if it is then check if it is a release or a press. If it is a
-    // press add it to the list of modifiers in use, otherwise remove it from the modifier list.
+    // check if key is a modifier, if it is a press add it to the list of modifiers in use,
+    // otherwise remove it from the modifier list.
     if ( m_KeyTable->isModifier ( key ) && notShiftOrAltGr ( key ) ) {
-        bool existed = false;
-        for ( auto it = m_ModSequence.begin(); it != m_ModSequence.end(); ++it ) {
-            if ( key == *it ) {
-                existed = true;
-                m_ModSequence.erase ( it );
-                break;
-            }
+        const auto it = std::find ( m_ModSequence.begin(), m_ModSequence.end(), key );
+        if ( !event.pressed && it != m_ModSequence.end() ) {
+            m_ModSequence.erase ( it );
+        } else if ( event.pressed && it == m_ModSequence.end() ) {
+            // anything held back was typed before the shortcut, so it has to reach the host first
+            releaseHeldBack();
+            m_ModSequence.push_back ( key );
         }
 
-        if ( !existed ) {
-            m_ModSequence.push_back ( key );
+        return;
+    }
+
+    // only keys which fit in our mask can be part of a chord
+    if ( !KeyMask::inRange ( key ) ) {
+        return;
+    }
+
+    if ( !event.pressed ) {
+        m_Held.reset ( key );
+        m_Withheld.reset ( key );
+
+        // the chord is complete once none of its keys are held down any more
+        if ( m_Captured.empty() || !( m_Captured & m_Held ).empty() ) {
+            return;
         }
 
+        takeChord();
         return;
     }
 
@@ -83,53 +248,211 @@ void hemiola::Hemiola::addKey ( const unsigned int key )
     }
 
     if ( key == KEY_SPACE || key == KEY_ENTER ) {
+        releaseHeldBack();
         m_Captured.clear();
+        m_Typed.clear();
         return;
     }
 
     if ( key == KEY_BACKSPACE ) {
+        releaseHeldBack();
         deleteKey();
         return;
     }
 
-    std::lock_guard<std::mutex> lock ( m_Mutex );
-    m_Captured [key] = std::chrono::steady_clock::now();
+    // a chord which timed out before this key was pressed is done with, even if the timer hasn't
+    // got round to it yet
+    expireKeys ( time );
+
+    if ( m_Captured.empty() && m_LastTyped ) {
+        m_Timing.addTyping ( time - m_LastPress );
+    }
+
+    m_Held.set ( key );
+    m_Captured.set ( key );
+    m_PressTimes [key] = time;
+    m_LastPress = time;
+
+    // keep track of what the host is sent for this key, so that it can be corrected later
+    if ( !m_Modifiers.test ( key ) ) {
+        KeyReport typed;
+        if ( m_Held.test ( KEY_LEFTSHIFT ) || m_Held.test ( KEY_RIGHTSHIFT ) ) {
+            typed.setModifier ( m_KeyTable->modToHex ( KEY_LEFTSHIFT ) );
+        }
+        typed.setKey ( m_KeyTable->scanToHex ( key ) );
+
+        // keys are only held back while they could still be part of a chord
+        if ( m_HoldBack && m_KeyChords->reachable ( m_Captured ) > 0 ) {
+            if ( m_HeldBack.empty() ) {
+                m_HoldStart = time;
+            }
+            m_HeldBack.push_back ( typed );
+            m_Withheld.set ( key );
+        } else {
+            releaseHeldBack();
+            m_Typed.push_back ( typed );
+        }
+    }
+
+    // if no further key could make this a different chord there is no need to wait for the
+    // release, a single key is left alone though as it is most likely just being typed
+    if ( m_Captured.size() > 1 && m_KeyChords->resolveUnique ( m_Captured ) != nullptr ) {
+        takeChord();
+        return;
+    }
+
+    m_Wakeup.notify_one();
 }
 
-void hemiola::Hemiola::run()
+hemiola::Hemiola::TimePoint hemiola::Hemiola::nextDeadline() const
 {
-    // Create a thread that runs the timer loop
-    m_TimerThread = std::thread ( [&] {
-        while ( true ) {
-            // Lock the mutex to access the shared data structures
-            std::lock_guard<std::mutex> lock ( m_Mutex );
-            // Iterate over the key codes in the combination
-            std::string chord;
-            for ( const auto& [keyCode, timestamp] : m_Captured ) {
-                // Check if the time threshold has passed since the key code was added
-                if ( std::chrono::steady_clock::now() - timestamp >= m_TimeThreshold ) {
-                    // add the key code to the chord if the time threshold has passed
-                    chord += m_KeyTable->charKeys ( keyCode );
-                    // Remove the key code from the combination
-                    m_Captured.erase ( keyCode );
-                }
-            }
-            // TODO: delete chord before sending word to output
-
-            // loop over word and send it to output
-            for ( const auto& charKey : m_KeyChords->getWord ( chord ) ) {
-                KeyReport report;
-                auto keyCode = m_KeyTable->getKeyCode ( std::string ( 1, charKey ) );
-                auto keyHex = m_KeyTable->scanToHex ( keyCode );
-                report.setKey ( keyHex );
-                m_Output->write ( report );
-                report.unsetKey ( keyHex );
-            }
+    auto deadline = TimePoint::max();
+    if ( !m_HeldBack.empty() ) {
+        deadline = m_HoldStart + m_MaxHold;
+    }
 
-            // Sleep for a short time before checking the timestamps again
-            std::this_thread::sleep_for ( std::chrono::milliseconds ( 10 ) );
-        }
+    if ( m_Captured.empty() ) {
+        return deadline;
+    }
+
+    // the chord times out once no key has been added to it for the time threshold
+    TimePoint lastPress {};
+    m_Captured.forEach ( [this, &lastPress] ( const auto key ) {
+        lastPress = std::max ( lastPress, m_PressTimes [key] );
     } );
+
+    return std::min ( deadline, lastPress + m_Timing.threshold ( m_Captured.size() ) );
+}
+
+void hemiola::Hemiola::expireKeys ( const TimePoint now )
+{
+    // keys can't be held back for longer than the maximum hold, even if the chord isn't done yet
+    if ( !m_HeldBack.empty() && now >= m_HoldStart + m_MaxHold ) {
+        releaseHeldBack();
+    }
+
+    if ( m_Captured.empty() || now < nextDeadline() ) {
+        return;
+    }
+
+    // keys of the timed out chord which are still held down don't start a new chord
+    takeChord();
+}
+
+void hemiola::Hemiola::takeChord()
+{
+    learnTiming ( m_Captured );
+
+    const auto* entry = m_KeyChords->resolve ( m_Captured );
+    if ( entry == nullptr ) {
+        // not a chord after all, so the host gets the keys as they were typed
+        releaseHeldBack();
+    } else {
+        // every character of the word is a press followed by a release, and only the characters
+        // after the longest common prefix with what the host has been sent need to be replaced
+        const auto reports = m_KeyChords->reports ( *entry );
+        const auto length = std::min ( m_Typed.size(), reports.size() / 2 );
+        std::size_t keep = 0;
+        while ( keep < length && m_Typed [keep] == reports.first [2 * keep] ) {
+            ++keep;
+        }
+
+        for ( auto erase = m_Typed.size() - keep; erase > 0; --erase ) {
+            queue ( m_Backspace, true );
+            queue ( KeyReport {}, true );
+        }
+
+        for ( auto report = reports.begin() + 2 * keep; report != reports.end(); ++report ) {
+            queue ( *report, true );
+        }
+
+        // the host now sees no keys held, so keys of the chord which are still down must not
+        // reach it again until they are pressed anew
+        m_Withheld |= m_Captured & m_Held;
+        m_HeldBack.clear();
+    }
+
+    m_Captured.clear();
+    m_Typed.clear();
+}
+
+void hemiola::Hemiola::releaseHeldBack()
+{
+    // each key is tapped on top of whatever the host already holds, so that other keys which are
+    // down stay down rather than being released and pressed again
+    const auto current = withhold ( m_LastReport );
+
+    // the keys stay withheld until they are released, as the host has already seen them typed
+    for ( const auto& typed : m_HeldBack ) {
+        auto press = current;
+        press.setModifier ( typed.modifiers );
+        for ( const auto key : typed.keys ) {
+            if ( key != 0x00 ) {
+                press.setKey ( key );
+            }
+        }
+        queue ( press );
+        queue ( current );
+        m_Typed.push_back ( typed );
+    }
+    m_HeldBack.clear();
+}
+
+void hemiola::Hemiola::learnTiming ( const KeyMask& chord )
+{
+    // keys which don't make up a word were typed, or rolled, rather than chorded
+    m_LastTyped = chord.size() < 2 || m_KeyChords->resolve ( chord ) == nullptr;
+    if ( m_LastTyped ) {
+        return;
+    }
+
+    std::size_t count = 0;
+    chord.forEach (
+        [this, &count] ( const auto key ) { m_ChordPresses [count++] = m_PressTimes [key]; } );
+    m_Timing.addChord ( m_ChordPresses.data(), count );
+}
+
+KeyReport hemiola::Hemiola::withhold ( KeyReport report ) const
+{
+    m_Withheld.forEach (
+        [this, &report] ( const auto key ) { report.unsetKey ( m_KeyTable->scanToHex ( key ) ); } );
+    return report;
+}
+
+void hemiola::Hemiola::queue ( const KeyReport& report, const bool bulk )
+{
+    m_Burst.reports.push_back ( report );
+    if ( m_Burst.runs.empty() || m_Burst.runs.back().second != bulk ) {
+        m_Burst.runs.emplace_back ( 0, bulk );
+    }
+    ++m_Burst.runs.back().first;
+    m_LastReport = report;
+}
+
+void hemiola::Hemiola::writeBurst ( std::unique_lock<std::mutex>& lock, const TimePoint since )
+{
+    if ( m_Burst.empty() ) {
+        lock.unlock();
+        return;
+    }
+
+    // take the queued reports and don't hold on to the lock while writing, so that key capture
+    // is never blocked, while still keeping bursts from different threads apart
+    std::lock_guard<std::mutex> output ( m_OutputMutex );
+    std::swap ( m_Burst, m_Writing );
+    lock.unlock();
+
+    // reports are timed from the event they result from, or from now if it isn't known, e.g.
+    // when a chord times out
+    const auto start = since != TimePoint {} ? since : std::chrono::steady_clock::now();
+
+    // each run, e.g. the backspaces and characters of a chord's word, is handed over at once
+    const auto* first = m_Writing.reports.data();
+    for ( const auto& [count, bulk] : m_Writing.runs ) {
+        m_Output->writeReports ( ReportSpan { first, count }, bulk, start );
+        first += count;
+    }
+    m_Writing.clear();
 }
 
 void hemiola::Hemiola::deleteKey()
@@ -137,33 +460,26 @@ void hemiola::Hemiola::deleteKey()
     // we should delete the most recent key that is not a modifier
     unsigned int deleteKey = KEY_RESERVED;
     TimePoint maxTime {};
-    for ( const auto& [key, value] : m_Captured ) {
-        // skip over modifers
-        if ( m_KeyTable->isModifier ( key ) ) {
-            continue;
-        }
-        if ( maxTime < value ) {
+    ( m_Captured - m_Modifiers ).forEach ( [this, &deleteKey, &maxTime] ( const auto key ) {
+        if ( maxTime < m_PressTimes [key] ) {
             deleteKey = key;
-            maxTime = value;
+            maxTime = m_PressTimes [key];
         }
-    }
+    } );
 
     if ( deleteKey == KEY_RESERVED ) {
         return;
     }
 
-    m_Captured.erase ( deleteKey );
-
-    // check to see if all keys are modifiers and then clear if they are
-    bool allModifiers = true;
-    for ( const auto& [key, value] : m_Captured ) {
-        if ( !m_KeyTable->isModifier ( key ) ) {
-            allModifiers = false;
-            break;
-        }
+    m_Captured.reset ( deleteKey );
+    // the host deletes the last character it was sent as well
+    if ( !m_Typed.empty() ) {
+        m_Typed.pop_back();
     }
 
-    if ( allModifiers ) {
+    // check to see if all keys are modifiers and then clear if they are
+    if ( ( m_Captured - m_Modifiers ).empty() ) {
         m_Captured.clear();
+        m_Typed.clear();
     }
 }
@@ -0,0 +1,476 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "InputManager.h"
+
+#include "Exceptions.h"
+#include "Keyboard.h"
+#include "Logger.h"
+#include "Utils.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <utility>
+
+using namespace hemiola;
+
+// the changes to the device directory which may mean a keyboard was plugged in or unplugged, udev
+// changing a new device's permissions being the point it can be opened
+const static uint32_t NOTIFY_MASK = IN_CREATE | IN_ATTRIB | IN_DELETE;
+
+// the most devices and events handled in a single poll
+const static std::size_t READY_EVENTS = 16;
+const static std::size_t BATCH_SIZE = 64;
+
+static bool isReport ( const input_event& event )
+{
+    return event.type == EV_SYN && event.code == SYN_REPORT;
+}
+
+/*!
+ * @brief stamp an event with the time now, on the same clock as monotonic keyboards
+ */
+static void stamp ( input_event& event, const timespec& now )
+{
+    event.input_event_sec = now.tv_sec;
+    event.input_event_usec = now.tv_nsec / 1000;
+}
+
+static timespec monotonicNow()
+{
+    timespec now {};
+    clock_gettime ( CLOCK_MONOTONIC, &now );
+    return now;
+}
+
+static bool before ( const input_event& lhs, const input_event& rhs )
+{
+    return lhs.input_event_sec < rhs.input_event_sec
+           || ( lhs.input_event_sec == rhs.input_event_sec
+                && lhs.input_event_usec < rhs.input_event_usec );
+}
+
+hemiola::InputManager::InputManager ( const std::string& devRoot,
+                                      std::shared_ptr<DeviceProbe> probe,
+                                      DeviceFactory factory )
+    : InputHID()
+    , m_Finder ( devRoot, std::move ( probe ) )
+    , m_Factory { std::move ( factory ) }
+    , m_NotifyId { -1 }
+    , m_LeftoverId { -1 }
+    , m_Leftover { false }
+    , m_WakeId { -1 }
+    , m_Devices {}
+    , m_Ready {}
+    , m_ReadyAt { 0 }
+    , m_Frames {}
+    , m_LostAt {}
+    , m_Recovery {}
+{
+    if ( !m_Factory ) {
+        m_Factory = [] ( const std::string& path ) { return std::make_shared<Keyboard> ( path ); };
+    }
+    m_HIDString = m_Finder.devRoot();
+}
+
+hemiola::InputManager::~InputManager()
+{
+    close();
+}
+
+void hemiola::InputManager::open()
+{
+    assert ( !m_Opened );
+
+    m_HIDId = epoll_create1 ( EPOLL_CLOEXEC );
+    if ( m_HIDId == -1 ) {
+        throw IoException ( "Unable to create epoll descriptor for keyboards", errno );
+    }
+    m_Opened = true;
+
+    // watch before listing the directory, so a keyboard plugged in meanwhile isn't missed
+    m_NotifyId = inotify_init1 ( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_NotifyId == -1 ) {
+        const auto error = errno;
+        close();
+        throw IoException ( "Unable to create inotify descriptor", error );
+    }
+    if ( inotify_add_watch ( m_NotifyId, m_Finder.devRoot().c_str(), NOTIFY_MASK ) == -1 ) {
+        const auto error = errno;
+        close();
+        throw IoException ( "Unable to watch " + m_Finder.devRoot(), error );
+    }
+
+    // events which didn't fit in to a read keep the epoll descriptor readable until they are read
+    m_LeftoverId = eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    if ( m_LeftoverId == -1 ) {
+        const auto error = errno;
+        close();
+        throw IoException ( "Unable to create eventfd for keyboards", error );
+    }
+
+    m_WakeId = eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    if ( m_WakeId == -1 ) {
+        const auto error = errno;
+        close();
+        throw IoException ( "Unable to create eventfd for waking keyboard reads", error );
+    }
+
+    for ( const auto fd : { m_NotifyId, m_LeftoverId, m_WakeId } ) {
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if ( epoll_ctl ( m_HIDId, EPOLL_CTL_ADD, fd, &event ) == -1 ) {
+            const auto error = errno;
+            close();
+            throw IoException ( "Unable to watch keyboard descriptors", error );
+        }
+    }
+
+    for ( const auto& path : m_Finder.findAll() ) {
+        attach ( path );
+    }
+    if ( m_Devices.empty() ) {
+        LOG ( WARN, "No keyboard found, waiting for one to be plugged in" );
+    }
+}
+
+void hemiola::InputManager::close()
+{
+    for ( auto& [fd, device] : m_Devices ) {
+        device.hid->close();
+    }
+    m_Devices.clear();
+    m_Ready.clear();
+    m_ReadyAt = 0;
+
+    for ( auto* fd : { &m_NotifyId, &m_LeftoverId, &m_WakeId } ) {
+        if ( *fd != -1 ) {
+            ::close ( *fd );
+            *fd = -1;
+        }
+    }
+    m_Leftover = false;
+    HID::close();
+    m_HIDId = -1;
+}
+
+void hemiola::InputManager::read ( input_event& event )
+{
+    while ( read ( &event, 1 ) == 0 ) {
+    }
+}
+
+std::size_t hemiola::InputManager::read ( input_event* events, const std::size_t count )
+{
+    assert ( m_Opened );
+
+    if ( m_ReadyAt == m_Ready.size() ) {
+        m_Ready.clear();
+        m_ReadyAt = 0;
+        poll();
+    }
+
+    const auto available = std::min ( count, m_Ready.size() - m_ReadyAt );
+    std::copy_n ( m_Ready.begin() + static_cast<std::ptrdiff_t> ( m_ReadyAt ), available, events );
+    m_ReadyAt += available;
+
+    const bool leftover = m_ReadyAt < m_Ready.size();
+    if ( leftover != m_Leftover ) {
+        uint64_t value = 1;
+        const auto result = leftover ? ::write ( m_LeftoverId, &value, sizeof ( value ) )
+                                     : ::read ( m_LeftoverId, &value, sizeof ( value ) );
+        if ( result == -1 ) {
+            throw IoException ( "Unable to signal leftover keyboard events", errno );
+        }
+        m_Leftover = leftover;
+    }
+
+    return available;
+}
+
+void hemiola::InputManager::wake()
+{
+    const uint64_t value = 1;
+    if ( m_WakeId != -1 && ::write ( m_WakeId, &value, sizeof ( value ) ) == -1 ) {
+        throw IoException ( "Unable to wake keyboard read", errno );
+    }
+}
+
+InputHID::KeyState hemiola::InputManager::keyState() const
+{
+    KeyState state;
+    for ( const auto& [fd, device] : m_Devices ) {
+        state |= device.hid->keyState();
+    }
+    return state;
+}
+
+void hemiola::InputManager::poll()
+{
+    std::array<epoll_event, READY_EVENTS> ready {};
+    const auto count = epoll_wait ( m_HIDId, ready.data(), ready.size(), -1 );
+    if ( count == -1 ) {
+        if ( errno == EINTR ) {
+            return;
+        }
+        throw IoException ( "Unable to wait for keyboards", errno );
+    }
+
+    // the keyboards are read before any are attached, so a descriptor is never reused by a new
+    // keyboard while the events for the old one are being handled
+    bool notified = false;
+    for ( int i = 0; i < count; ++i ) {
+        const auto fd = ready [i].data.fd;
+        const auto device = m_Devices.find ( fd );
+        if ( fd == m_NotifyId ) {
+            notified = true;
+        } else if ( fd == m_WakeId ) {
+            // nothing is handed out for a wake up, the reader just gets to check why it was woken
+            uint64_t value = 0;
+            if ( ::read ( m_WakeId, &value, sizeof ( value ) ) == -1 && errno != EAGAIN ) {
+                throw IoException ( "Unable to read keyboard wake up", errno );
+            }
+        } else if ( device != m_Devices.end() ) {
+            readDevice ( device->second );
+        }
+    }
+    if ( notified ) {
+        readNotifications();
+    }
+
+    mergeFrames();
+
+    for ( auto device = m_Devices.begin(); device != m_Devices.end(); ) {
+        const auto fd = device->first;
+        const auto lost = device->second.lost;
+        ++device;
+        if ( lost ) {
+            detach ( fd );
+        }
+    }
+}
+
+void hemiola::InputManager::readDevice ( Device& device )
+{
+    const auto start = device.pending.size();
+    device.pending.resize ( start + BATCH_SIZE );
+    std::size_t count = 0;
+    try {
+        count = device.hid->read ( device.pending.data() + start, BATCH_SIZE );
+    } catch ( const IoException& e ) {
+        LOG ( WARN, "Keyboard {} was lost: {}, {}", device.path, e.what(), e.code() );
+        device.lost = true;
+    }
+    device.pending.resize ( start + count );
+
+    // keyboards are merged and keys timed on the monotonic clock, so a keyboard stuck on the wall
+    // clock has its events stamped when they are read instead
+    const auto now = monotonicNow();
+    const auto restamp = !device.hid->monotonicTime();
+    for ( auto event = device.pending.begin() + static_cast<std::ptrdiff_t> ( start );
+          event != device.pending.end();
+          ++event ) {
+        if ( restamp ) {
+            stamp ( *event, now );
+        }
+        if ( event->type == EV_KEY && event->value != EV_REPEAT ) {
+            device.held [event->code] = event->value != 0;
+        }
+    }
+}
+
+void hemiola::InputManager::readNotifications()
+{
+    alignas ( inotify_event ) std::array<char, 4096> buffer;
+    while ( true ) {
+        const auto bytes = ::read ( m_NotifyId, buffer.data(), buffer.size() );
+        if ( bytes <= 0 ) {
+            if ( bytes == -1 && errno == EINTR ) {
+                continue;
+            }
+            return;  // EAGAIN, everything has been read
+        }
+
+        for ( ssize_t offset = 0; offset < bytes; ) {
+            inotify_event notification;
+            std::memcpy ( &notification, buffer.data() + offset, sizeof ( notification ) );
+            const std::string file { notification.len > 0
+                                         ? buffer.data() + offset + sizeof ( inotify_event )
+                                         : "" };
+            offset += static_cast<ssize_t> ( sizeof ( inotify_event ) + notification.len );
+
+            if ( ( notification.mask & IN_Q_OVERFLOW ) != 0 ) {
+                // changes were missed, so look at everything again
+                for ( const auto& path : m_Finder.findAll() ) {
+                    attach ( path );
+                }
+                continue;
+            }
+
+            if ( !KeyboardFinder::isEventDevice ( file ) ) {
+                continue;
+            }
+
+            const auto path = m_Finder.devRoot() + file;
+            if ( ( notification.mask & IN_DELETE ) != 0 ) {
+                for ( auto& [fd, device] : m_Devices ) {
+                    if ( device.path == path ) {
+                        LOG ( INFO, "Keyboard {} was unplugged", path );
+                        device.lost = true;
+                    }
+                }
+            } else if ( m_Finder.isKeyboard ( path ) ) {
+                attach ( path );
+            }
+        }
+    }
+}
+
+void hemiola::InputManager::attach ( const std::string& path )
+{
+    for ( const auto& [fd, device] : m_Devices ) {
+        if ( device.path == path && !device.lost ) {
+            return;
+        }
+    }
+
+    std::shared_ptr<InputHID> hid;
+    try {
+        hid = m_Factory ( path );
+        hid->open();
+    } catch ( const std::exception& e ) {
+        // udev may not have finished setting the device up, it is tried again once it has
+        LOG ( WARN, "Unable to attach keyboard {}: {}", path, e.what() );
+        return;
+    }
+
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.fd = hid->fd();
+    if ( epoll_ctl ( m_HIDId, EPOLL_CTL_ADD, hid->fd(), &event ) == -1 ) {
+        LOG ( WARN, "Unable to watch keyboard {}: {}", path, errno );
+        hid->close();
+        return;
+    }
+
+    LOG ( INFO, "Attached keyboard {}", path );
+    const auto fd = hid->fd();
+    auto& device = m_Devices [fd];
+    device.path = path;
+    device.hid = std::move ( hid );
+    device.pending.reserve ( BATCH_SIZE );
+
+    if ( m_LostAt ) {
+        m_Recovery.add ( std::chrono::steady_clock::now() - *m_LostAt );
+        m_LostAt.reset();
+    }
+}
+
+void hemiola::InputManager::detach ( const int fd )
+{
+    const auto found = m_Devices.find ( fd );
+    assert ( found != m_Devices.end() );
+    auto& device = found->second;
+
+    KeyState others;
+    for ( const auto& [otherFd, other] : m_Devices ) {
+        if ( otherFd != fd ) {
+            others |= other.held;
+        }
+    }
+
+    // the events of a frame which was never finished are thrown away, and a frame releasing
+    // whatever was only held on this keyboard takes its place
+    const auto now = monotonicNow();
+    const auto released = device.held & ~others;
+    for ( std::size_t key = 0; key < released.size(); ++key ) {
+        if ( released [key] ) {
+            input_event event {};
+            stamp ( event, now );
+            event.type = EV_KEY;
+            event.code = static_cast<uint16_t> ( key );
+            event.value = 0;
+            m_Ready.push_back ( event );
+        }
+    }
+    if ( released.any() ) {
+        input_event report {};
+        stamp ( report, now );
+        report.type = EV_SYN;
+        report.code = SYN_REPORT;
+        m_Ready.push_back ( report );
+    }
+
+    epoll_ctl ( m_HIDId, EPOLL_CTL_DEL, fd, nullptr );
+    device.hid->close();
+    LOG ( INFO, "Detached keyboard {}", device.path );
+    m_Devices.erase ( found );
+
+    if ( !m_LostAt ) {
+        m_LostAt = std::chrono::steady_clock::now();
+    }
+}
+
+void hemiola::InputManager::mergeFrames()
+{
+    m_Frames.clear();
+    for ( auto& [fd, device] : m_Devices ) {
+        std::size_t begin = 0;
+        for ( std::size_t i = 0; i < device.pending.size(); ++i ) {
+            if ( isReport ( device.pending [i] ) ) {
+                m_Frames.push_back ( Frame { &device, begin, i + 1 } );
+                begin = i + 1;
+            }
+        }
+    }
+
+    // a single keyboard's frames are already in order, so only several need sorting
+    if ( m_Devices.size() > 1 ) {
+        std::stable_sort (
+            m_Frames.begin(), m_Frames.end(), [] ( const Frame& lhs, const Frame& rhs ) {
+                return before ( lhs.report(), rhs.report() );
+            } );
+    }
+
+    for ( const auto& frame : m_Frames ) {
+        const auto& pending = frame.device->pending;
+        m_Ready.insert ( m_Ready.end(),
+                         pending.begin() + static_cast<std::ptrdiff_t> ( frame.begin ),
+                         pending.begin() + static_cast<std::ptrdiff_t> ( frame.end ) );
+    }
+
+    // keep the start of the next frame for the next poll
+    for ( auto& [fd, device] : m_Devices ) {
+        auto& pending = device.pending;
+        const auto last = std::find_if ( pending.rbegin(), pending.rend(), isReport );
+        pending.erase ( pending.begin(), last.base() );
+    }
+}
@@ -19,23 +19,42 @@
 */
 #include "KeyChords.h"
 
+#include "Exceptions.h"
 #include "Logger.h"
 
+#ifdef HEMIOLA_BUILTIN_DICTIONARY
+#include "BuiltinDictionary.h"
+#endif
+
+#include <sys/stat.h>
 #include <yaml-cpp/yaml.h>
 
-#include <queue>
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <utility>
 
 using namespace hemiola;
 
 const static std::string CONFIG { "config/settings.yml" };
+const static std::string DICTIONARY { "config/chords.bin" };
 
 const static char DEFAULT_DUP { '=' };
 const static char DEFAULT_PLURAL { ';' };
 const static char DEFAULT_PAST { ',' };
 const static char SEPARATOR { '+' };
 
+const static std::string DUP { "dup" };
+const static std::string PLURAL { "plural" };
+const static std::string PAST { "past" };
+
+// characters which are typed with shift held, and the character on the same key
+const static std::string SHIFTED { "~!@#$%^&*()_+{}|:\"<>?" };
+const static std::string UNSHIFTED { "`1234567890-=[]\\;',./" };
+
 hemiola::KeyChords::KeyChords ( std::shared_ptr<KeyTable> keyTable )
-    : m_ChordMap {}
+    : m_Image { std::make_unique<ChordImage> ( ChordImage::compile ( {}, 0, 0, 0 ) ) }
+    , m_Builtin { false }
     , m_Dup { KEY_RESERVED }
     , m_Plural { KEY_RESERVED }
     , m_Past { KEY_RESERVED }
@@ -44,7 +63,12 @@ hemiola::KeyChords::KeyChords ( std::shared_ptr<KeyTable> keyTable )
 
 void hemiola::KeyChords::buildMap()
 {
-    auto config = YAML::LoadFile ( CONFIG );
+    buildMap ( CONFIG );
+}
+
+void hemiola::KeyChords::buildMap ( const std::string& configFile, const bool strict )
+{
+    auto config = YAML::LoadFile ( configFile );
 
     if ( config ["dup"] ) {
         m_Dup = m_KeyTable->getKeyCode ( config ["dup"].as<std::string>() );
@@ -60,88 +84,232 @@ void hemiola::KeyChords::buildMap()
 
     if ( m_Dup == KEY_RESERVED ) {
         LOG ( DEBUG, "Using default dup key" );
-        m_Dup = DEFAULT_DUP;
+        m_Dup = m_KeyTable->getKeyCode ( std::string ( 1, DEFAULT_DUP ) );
     }
 
     if ( m_Plural == KEY_RESERVED ) {
         LOG ( DEBUG, "Using default plural key" );
-        m_Plural = DEFAULT_PLURAL;
+        m_Plural = m_KeyTable->getKeyCode ( std::string ( 1, DEFAULT_PLURAL ) );
     }
 
     if ( m_Past == KEY_RESERVED ) {
         LOG ( DEBUG, "Using default past key" );
-        m_Past = DEFAULT_PAST;
+        m_Past = m_KeyTable->getKeyCode ( std::string ( 1, DEFAULT_PAST ) );
     }
 
+    std::vector<ChordSource> chords;
+    // position of each chord in chords, to find clashes
+    std::unordered_map<KeyMask, std::size_t, KeyMaskHasher> positions;
     if ( config ["chords"] && config ["chords"].IsMap() ) {
         for ( auto it = config ["chords"].begin(); it != config ["chords"].end(); ++it ) {
             const auto key = it->first;
             const auto value = it->second;
             if ( key.Type() == YAML::NodeType::Scalar && value.Type() == YAML::NodeType::Scalar ) {
-                // TODO parse the value
                 auto chord = parseChord ( value.as<std::string>() );
-                if ( !chord.empty() && m_ChordMap.count ( chord ) == 0 ) {
-                    m_ChordMap [chord] = key.as<std::string>();
-                } else if ( !chord.empty() ) {
+                if ( chord.empty() ) {
+                    continue;
+                }
+
+                const auto clash = positions.find ( chord );
+                if ( clash != positions.end() && strict ) {
+                    throw DictionaryException ( "The provided chord (" + key.as<std::string>()
+                                                + ") clashes with another chord ("
+                                                + chords [clash->second].word + ")." );
+                }
+                if ( clash != positions.end() ) {
                     LOG ( WARN,
                           "The provided chord ({}) clashes with another chord ({}).",
                           key.as<std::string>(),
-                          m_ChordMap.at ( chord ) );
+                          chords [clash->second].word );
+                    continue;
+                }
+
+                auto word = key.as<std::string>();
+                auto reports = compileWord ( word );
+                if ( reports ) {
+                    positions.emplace ( chord, chords.size() );
+                    chords.push_back (
+                        ChordSource { chord, std::move ( word ), std::move ( *reports ) } );
                 }
             } else {
                 LOG ( WARN, "Nested chords are not supported." );
             }
         }
     }
+
+    m_Image
+        = std::make_unique<ChordImage> ( ChordImage::compile ( chords, m_Dup, m_Plural, m_Past ) );
+    m_Builtin = false;
+}
+
+void hemiola::KeyChords::load()
+{
+#ifdef HEMIOLA_BUILTIN_DICTIONARY
+    // nothing to read or build, the dictionary is used where it was compiled in
+    m_Image = std::make_unique<ChordImage> ( builtin::IMAGE, sizeof ( builtin::IMAGE ) );
+    m_Builtin = true;
+    m_Dup = m_Image->header().dup;
+    m_Plural = m_Image->header().plural;
+    m_Past = m_Image->header().past;
+    LOG ( INFO, "Using the {} chords compiled in to hemiola", m_Image->size() );
+    return;
+#endif
+
+    // a dictionary older than the settings file is missing whatever was changed since
+    struct stat dictionary {};
+    struct stat config {};
+    if ( stat ( DICTIONARY.c_str(), &dictionary ) == 0 ) {
+        if ( stat ( CONFIG.c_str(), &config ) == 0 && config.st_mtime > dictionary.st_mtime ) {
+            LOG ( WARN,
+                  "{} is older than {}, recompile it with hemiola-dictc",
+                  DICTIONARY,
+                  CONFIG );
+        } else {
+            loadImage ( DICTIONARY );
+            return;
+        }
+    }
+
+    buildMap ( CONFIG );
+}
+
+void hemiola::KeyChords::loadImage ( const std::string& dictionary )
+{
+    m_Image = std::make_unique<ChordImage> ( dictionary );
+    m_Builtin = false;
+    m_Dup = m_Image->header().dup;
+    m_Plural = m_Image->header().plural;
+    m_Past = m_Image->header().past;
+    LOG ( INFO, "Loaded {} chords from {}", m_Image->size(), dictionary );
 }
 
-std::set<unsigned int> hemiola::KeyChords::parseChord ( std::string chord )
+void hemiola::KeyChords::saveImage ( const std::string& dictionary ) const
+{
+    m_Image->save ( dictionary );
+}
+
+KeyMask hemiola::KeyChords::parseChord ( std::string chord ) const
 {
     // remove all white space
     chord.erase ( std::remove_if ( chord.begin(), chord.end(), ::isspace ), chord.end() );
 
-    std::queue<std::size_t> seps;
+    // we assume chords are written with letters first and then special keys, e.g. "bg+past"
+    const auto letters = chord.substr ( 0, chord.find ( SEPARATOR ) );
+
+    KeyMask chordMask;
+    for ( const auto letter : letters ) {
+        const auto key = m_KeyTable->getKeyCode ( std::string ( 1, letter ) );
+        if ( key == KEY_RESERVED || !KeyMask::inRange ( key ) ) {
+            LOG ( WARN, "Unknown key in chord: {}", letter );
+            return KeyMask {};
+        }
+        chordMask.set ( key );
+    }
+
     // search through string until no separator is found
-    for ( std::size_t indx = chord.find ( SEPARATOR, 0 ); indx != std::string::npos;
-          indx = chord.find ( SEPARATOR, indx + 1 ) ) {
-        seps.push ( indx );
+    for ( auto begin = letters.size(); begin < chord.size(); ) {
+        const auto end = chord.find ( SEPARATOR, begin + 1 );
+        const auto special = chord.substr ( begin + 1, end - begin - 1 );
+
+        if ( special == DUP ) {
+            chordMask.set ( m_Dup );
+        } else if ( special == PLURAL ) {
+            chordMask.set ( m_Plural );
+        } else if ( special == PAST ) {
+            chordMask.set ( m_Past );
+        } else {
+            LOG ( WARN, "Unknown special in chord: {}", special );
+            return KeyMask {};
+        }
+
+        begin = end;
     }
 
-    // we assume chords are written with letters first and then special characters
-    std::size_t end = seps.empty() ? chord.size() : seps.front() + 1;
-    seps.pop();
+    return chordMask;
+}
 
-    std::set<unsigned int> chordSet;
-    // empty spaces have been removed so don't worry about them
-    for ( size_t i = 0; i < end; ++i ) {
-        std::string token { chord.at ( i ) };
-        chordSet.insert ( m_KeyTable->getKeyCode ( token ) );
+std::string hemiola::KeyChords::getWord ( const std::string& chord ) const
+{
+    const auto word = getWord ( parseChord ( chord ) );
+    return word.empty() ? chord : std::string ( word );
+}
+
+std::string_view hemiola::KeyChords::getWord ( const KeyMask& chord ) const
+{
+    const auto* entry = resolve ( chord );
+    return entry == nullptr ? std::string_view {} : m_Image->word ( *entry );
+}
+
+const Chord* hemiola::KeyChords::resolve ( const KeyMask& chord ) const
+{
+#ifdef HEMIOLA_BUILTIN_DICTIONARY
+    if ( m_Builtin ) {
+        const auto* slot = builtin::find ( chord.words );
+        return slot == nullptr ? nullptr : &m_Image->entry ( slot->entry );
     }
+#endif
 
-    while ( !seps.empty() ) {
-        auto begin = end;
-        end = seps.front() != std::string::npos ? seps.front() + 1 : chord.size();
-        seps.pop();
+    return m_Image->find ( chord );
+}
 
-        auto special = std::string { chord.begin() + begin, chord.begin() + end };
+std::size_t hemiola::KeyChords::reachable ( const KeyMask& keys ) const
+{
+    if ( keys.empty() ) {
+        return m_Image->size();
+    }
 
-        if ( special == m_KeyTable->charKeys ( m_Dup ) ) {
-            chordSet.insert ( m_Dup );
-        } else if ( special == m_KeyTable->charKeys ( m_Plural ) ) {
-            chordSet.insert ( m_Plural );
-        } else if ( special == m_KeyTable->charKeys ( m_Past ) ) {
-            chordSet.insert ( m_Past );
-        } else {
-            LOG ( WARN, "Unknown special in chord: {}", special );
+    // only the chords containing the key with the fewest chords need to be checked
+    std::optional<IndexSpan> candidates;
+    keys.forEach ( [this, &candidates] ( const auto key ) {
+        const auto chords = m_Image->chordsWith ( key );
+        if ( !candidates || chords.size() < candidates->size() ) {
+            candidates = chords;
         }
-    }
+    } );
+
+    const auto count = std::count_if (
+        candidates->begin(), candidates->end(), [this, &keys] ( const auto slot ) {
+            return m_Image->chord ( slot ).contains ( keys );
+        } );
+
+    return static_cast<std::size_t> ( count );
+}
 
-    return chordSet;
+const Chord* hemiola::KeyChords::resolveUnique ( const KeyMask& keys ) const
+{
+    // a chord is only reachable from itself if no other chord contains it
+    const auto* entry = resolve ( keys );
+    return entry != nullptr && reachable ( keys ) == 1 ? entry : nullptr;
 }
 
-std::string hemiola::KeyChords::getWord ( const std::string& chord )
+std::optional<std::vector<KeyReport>>
+hemiola::KeyChords::compileWord ( const std::string& word ) const
 {
-    auto chordSet = parseChord ( chord );
-    return ( chordSet.empty() || m_ChordMap.count ( chordSet ) > 0 ) ? m_ChordMap [chordSet]
-                                                                     : chord;
+    std::vector<KeyReport> reports;
+    reports.reserve ( 2 * word.size() );
+    for ( auto character : word ) {
+        KeyReport press;
+        const auto shifted = SHIFTED.find ( character );
+        if ( std::isupper ( static_cast<unsigned char> ( character ) ) ) {
+            press.setModifier ( m_KeyTable->modToHex ( KEY_LEFTSHIFT ) );
+            character
+                = static_cast<char> ( std::tolower ( static_cast<unsigned char> ( character ) ) );
+        } else if ( shifted != std::string::npos ) {
+            press.setModifier ( m_KeyTable->modToHex ( KEY_LEFTSHIFT ) );
+            character = UNSHIFTED [shifted];
+        }
+
+        const auto key = m_KeyTable->getKeyCode ( std::string ( 1, character ) );
+        if ( key == KEY_RESERVED ) {
+            LOG ( WARN, "Unable to type '{}' in word: {}", character, word );
+            return std::nullopt;
+        }
+
+        press.setKey ( m_KeyTable->scanToHex ( key ) );
+        reports.push_back ( press );
+        // release everything between characters so that repeated characters are seen by the host
+        reports.push_back ( KeyReport {} );
+    }
+
+    return reports;
 }
@@ -25,98 +25,72 @@
 #include "Logger.h"
 #include "Utils.h"
 
-#include <bitset>
-#include <cassert>
-#include <sstream>
 #include <string>
 
 using namespace hemiola;
 
-hemiola::KeyTable::KeyTable()
-    : m_KeyCodeMap {}
+std::string_view hemiola::KeyTable::charKeys ( const unsigned int code ) const
 {
-    // build our key code map
-    for ( const auto& [key, keyRep] : m_CharKeys ) {
-        m_KeyCodeMap [keyRep] = key;
-    }
-
-    for ( const auto& [key, keyRep] : m_ModKeys ) {
-        m_KeyCodeMap [keyRep] = key;
-    }
-}
-
-std::string hemiola::KeyTable::charKeys ( const unsigned int code ) const
-{
-    try {
-        return m_CharKeys.at ( code );
-    } catch ( ... ) {
+    if ( !isCharKey ( code ) ) {
         LOG ( WARN, "Key is not represented as a character: {}", code );
-        return "";
+        return {};
     }
+
+    return TABLE [code].name;
 }
 
-std::string hemiola::KeyTable::modKeys ( const unsigned int code ) const
+std::string_view hemiola::KeyTable::modKeys ( const unsigned int code ) const
 {
-    try {
-        return m_ModKeys.at ( code );
-    } catch ( ... ) {
+    if ( !isScanModifier ( code ) ) {
         LOG ( WARN, "Invalid modifier key code: {}", code );
-        return "";
+        return {};
     }
+
+    return TABLE [code].name;
 }
 
 std::string hemiola::KeyTable::beginModKey ( const uint8_t code ) const
 {
     auto key = modKeys ( code );
-    return key.empty() ? key : fmt::format ( m_BeginModifierFmt, key );
+    return key.empty() ? std::string {} : fmt::format ( BEGIN_MODIFIER_FMT, key );
 }
 
 std::string hemiola::KeyTable::endModKey ( const uint8_t code ) const
 {
     auto key = modKeys ( code );
-    return key.empty() ? key : fmt::format ( m_EndModifierFmt, key );
-}
-
-bool hemiola::KeyTable::isTypeModifier (
-    const std::string& key,
-    std::function<std::string ( const unsigned int )> typePredicate ) const
-{
-    for ( const auto& [modKey, modString] : m_ModKeys ) {
-        if ( typePredicate ( modKey ) == key ) {
-            return true;
-        }
-    }
-
-    return false;
+    return key.empty() ? std::string {} : fmt::format ( END_MODIFIER_FMT, key );
 }
 
 uint8_t hemiola::KeyTable::scanToHex ( const unsigned int code ) const
 {
-    try {
-        return m_HexValues.at ( code );
-    } catch ( ... ) {
+    // a hex value of 0x00 means the key can't be sent in a key report
+    if ( code >= SIZE || TABLE [code].hex == 0x00 ) {
         LOG ( ERROR, "Unknown key code: {}", code );
         return 0x00;
     }
+
+    return TABLE [code].hex;
 }
 
 uint8_t hemiola::KeyTable::modToHex ( const unsigned int code ) const
 {
-    try {
-        return m_ModifierHex.at ( code );
-    } catch ( ... ) {
+    if ( !isScanModifier ( code ) ) {
         LOG ( ERROR, "Unknown modifier key code: {}", code );
         return 0x00;
     }
+
+    return TABLE [code].modifierHex;
 }
 
 unsigned int hemiola::KeyTable::getKeyCode ( const std::string& keyRep ) const
 {
-    unsigned int keyCode = KEY_RESERVED;
-
-    if ( m_KeyCodeMap.count ( keyRep ) > 0 ) {
-        keyCode = m_KeyCodeMap.at ( keyRep );
+    // only used when loading the dictionary, so a scan of the table is fine
+    for ( unsigned int key = 0; key < SIZE; ++key ) {
+        if ( ( TABLE [key].flags & ( KeyInfo::CHARACTER | KeyInfo::MODIFIER ) ) != 0
+             && TABLE [key].name == keyRep ) {
+            return key;
+        }
     }
 
-    return keyCode;
+    return KEY_RESERVED;
 }
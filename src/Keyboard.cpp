@@ -20,135 +20,98 @@
 #include "Keyboard.h"
 
 #include "Exceptions.h"
+#include "KeyboardFinder.h"
 #include "Logger.h"
 #include "Utils.h"
 
 #include <fcntl.h>
 #include <linux/input.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
-#include <algorithm>
+#include <array>
 #include <cassert>
-#include <fstream>
-#include <iostream>
-#include <queue>
-#include <sstream>
-#include <utility>
+#include <cerrno>
+#include <ctime>
 
 using namespace hemiola;
-using ScoredHID = std::pair<std::string, unsigned short>;
 
 hemiola::Keyboard::Keyboard()
     : InputHID()
+    , m_Monotonic { false }
 {}
 
+hemiola::Keyboard::Keyboard ( const std::string& device )
+    : InputHID()
+    , m_Monotonic { false }
+{
+    m_HIDString = device;
+}
+
 void hemiola::Keyboard::open()
 {
-    m_HIDString = getKeyboard();
+    if ( m_HIDString.empty() ) {
+        m_HIDString = getKeyboard();
+    }
 
     HID::open ( O_RDONLY );
+
+    // evdev stamps events with the wall clock by default, which can jump, whereas chords are
+    // timed with the steady clock
+    int clock = CLOCK_MONOTONIC;
+    m_Monotonic = ioctl ( m_HIDId, EVIOCSCLOCKID, &clock ) == 0;
+    if ( !m_Monotonic ) {
+        LOG ( WARN,
+              "Unable to switch {} to monotonic timestamps, keys are timed when read: {}",
+              m_HIDString,
+              errno );
+    }
 }
 
 std::string hemiola::Keyboard::getKeyboard()
 {
-    // better be safe than sory: while running other programs, switch user to nobody from root
-    if ( setegid ( 65534 ) < 0 ) {
-        throw CodedException ( "Unable to set user group to 65534", errno );
-    }
-    if ( seteuid ( 65534 ) < 0 ) {
-        throw CodedException ( "Unable to set user id to 65534", errno );
-    }
+    // the devices are asked directly with ioctls, so there is nothing to run and no need to give
+    // up root while doing so
+    return KeyboardFinder ( INPUT_EVENT_PATH ).find();
+}
 
-    // Look for devices with keybit bitmask that has keys a keyboard does
-    // If a bitmask ends with 'e', it supports KEY_2, KEY_1, KEY_ESC, and KEY_RESERVED is set to 0,
-    // so it's probably a keyboard keybit:
-    // https://github.com/torvalds/linux/blob/02de58b24d2e1b2cf947d57205bd2221d897193c/include/linux/input.h#L45
-    // keycodes:
-    // https://github.com/torvalds/linux/blob/139711f033f636cc78b6aaf7363252241b9698ef/include/uapi/linux/input-event-codes.h#L75
-    // Take the Name, Handlers, and KEY values
-    const char* cmd = EXE_GREP " -B8 -E 'KEY=.*e$' /proc/bus/input/devices | " EXE_GREP
-                               " -E 'Name|Handlers|KEY' ";
-    std::stringstream output;
-    try {
-        output << execute ( cmd );
-    } catch ( const ExecutionException& e ) {
-        // log the error and rethrow
-        LOG ( ERROR, "Failed to grep for keyboard device." );
-        throw;
-    }
+void hemiola::Keyboard::read ( input_event& event )
+{
+    read ( &event, 1 );
+}
 
-    auto comparator
-        = [] ( const ScoredHID& dev1, const ScoredHID& dev2 ) { return dev1.second > dev2.second; };
-    std::priority_queue<ScoredHID, std::vector<ScoredHID>, decltype ( comparator )> devices (
-        comparator );
-    std::string line;
-
-    std::string device;
-    unsigned short lineType = 0;
-    unsigned short score = 0;
-
-    while ( std::getline ( output, line ) ) {
-        std::transform ( line.begin(), line.end(), line.begin(), ::tolower );
-
-        // Generate score based on device name
-        if ( lineType == 0 ) {
-            if ( line.find ( "keyboard" ) != std::string::npos ) {
-                score += 100;
-            }
-        } else if ( lineType == 1 ) {  // Add the event handler
-            std::string::size_type i = line.find ( "event" );
-            if ( i != std::string::npos )
-                i += 5;  // "event".size() == 5
-            if ( i < line.size() ) {
-                int index = atoi ( &line.c_str() [i] );
-
-                if ( index != -1 ) {
-                    std::stringstream inputDevicePath;
-                    inputDevicePath << INPUT_EVENT_PATH;
-                    inputDevicePath << "event";
-                    inputDevicePath << index;
-
-                    // save device string for next iteration where we determine score
-                    device = inputDevicePath.str();
-                }
-            }
-        } else if ( lineType == 2 ) {  // Generate score based on size of key bitmask
-            std::string::size_type i = line.find ( "=" );
-            std::string full_key_map = line.substr ( i + 1 );
-            score += full_key_map.length();
-            devices.push ( std::make_pair ( device, score ) );
-            score = 0;
-            device = "";
-        }
-        lineType = ( lineType + 1 ) % 3;
-    }
+std::size_t hemiola::Keyboard::read ( input_event* events, const std::size_t count )
+{
+    assert ( m_Opened );
 
-    if ( devices.size() == 0 ) {
-        LOG ( ERROR,
-              "Please post contents of your /proc/bus/input/devices file as a new bug report.\n"
-              "github.com/erichlf/hemiola" );
-        throw KeyboardException ( "Couldn't determine keyboard." );
+    // evdev hands out whole events, as many as are queued and fit, in a single read
+    auto bytes = ::read ( m_HIDId, events, sizeof ( struct input_event ) * count );
+    while ( bytes == -1 && errno == EINTR ) {
+        bytes = ::read ( m_HIDId, events, sizeof ( struct input_event ) * count );
     }
 
-    // now we reclaim those root privileges
-    if ( setegid ( 0 ) < 0 ) {
-        throw CodedException ( "Unable to set user group to 0", errno );
+    if ( bytes == -1 ) {
+        throw IoException ( "Unable to read from input device", errno );
     }
-    if ( seteuid ( 0 ) < 0 ) {
-        throw CodedException ( "Unable to set user id to 0", errno );
+    // end of file is the device having been removed, errno isn't set for it
+    if ( bytes == 0 ) {
+        throw IoException ( "Input device was removed", ENODEV );
     }
-
-    LOG ( INFO, "Found device: {}", devices.top().first );
-
-    // Choose device with the best score
-    return devices.top().first;
+    return static_cast<std::size_t> ( bytes ) / sizeof ( struct input_event );
 }
 
-void hemiola::Keyboard::read ( input_event& event )
+InputHID::KeyState hemiola::Keyboard::keyState() const
 {
     assert ( m_Opened );
 
-    if ( ::read ( m_HIDId, &event, sizeof ( struct input_event ) ) <= 0 ) {
-        throw IoException ( "Unable to read from input device", errno );
+    std::array<uint8_t, ( KEY_CNT + 7 ) / 8> bits {};
+    if ( ioctl ( m_HIDId, EVIOCGKEY ( bits.size() ), bits.data() ) == -1 ) {
+        throw IoException ( "Unable to query key state of input device", errno );
     }
-}
+
+    KeyState state;
+    for ( std::size_t key = 0; key < state.size(); ++key ) {
+        state [key] = ( bits [key / 8] & ( 1u << ( key % 8 ) ) ) != 0;
+    }
+    return state;
+}
\ No newline at end of file
@@ -29,6 +29,7 @@
 
 #include <bitset>
 #include <cassert>
+#include <chrono>
 #include <cwctype>
 #include <iostream>
 #include <string>
@@ -38,19 +39,28 @@ using namespace hemiola;
 hemiola::KeyboardEvents::KeyboardEvents ( std::shared_ptr<KeyTable> keyTable,
                                           std::shared_ptr<InputHID> device )
     : m_KeyReport {}
-    , m_KeyRep {}
+    , m_KeyEvent {}
+    , m_Held {}
+    , m_FrameReport {}
+    , m_FrameHeld {}
+    , m_Dropping { false }
+    , m_Drops { 0 }
+    , m_Frame {}
+    , m_Events {}
     , m_KeyTable { std::move ( keyTable ) }
     , m_InputHID ( std::move ( device ) )
-{}
+    , m_Stop { false }
+{
+    // a frame rarely holds more than a couple of keys, so this is never grown while capturing
+    m_Frame.reserve ( 16 );
+}
 
-void hemiola::KeyboardEvents::capture ( std::function<void ( KeyReport, unsigned int )> onEvent,
+void hemiola::KeyboardEvents::capture ( std::function<void ( KeyReport, KeyEvent )> onEvent,
                                         std::function<void ( std::exception_ptr )> onError )
 {
     try {
-        input_event event {};
-        while ( getEvent ( event ) ) {
-            updateKeyState ( event );           // process the captured event
-            onEvent ( m_KeyReport, m_KeyRep );  // send the scan code directly to the output
+        while ( !m_Stop ) {
+            captureEvents ( onEvent );
         }
     } catch ( ... ) {
         LOG ( ERROR, "An error occurred while reading keyboard event" );
@@ -59,27 +69,138 @@ void hemiola::KeyboardEvents::capture ( std::function<void ( KeyReport, unsigned
     }
 }
 
-bool hemiola::KeyboardEvents::getEvent ( input_event& event ) const
+void hemiola::KeyboardEvents::stop()
 {
-    try {
-        m_InputHID->read ( event );
-    } catch ( ... ) {
-        LOG ( ERROR, "Connection to keyboard seems to have been lost while updating key state" );
-        throw;
+    m_Stop = true;
+    m_InputHID->wake();
+}
+
+void hemiola::KeyboardEvents::captureEvents (
+    const std::function<void ( KeyReport, KeyEvent )>& onEvent )
+{
+    const auto count = getEvents();
+    for ( std::size_t i = 0; i < count; ++i ) {
+        processEvent ( m_Events [i], onEvent );
     }
+}
+
+void hemiola::KeyboardEvents::processEvent (
+    const input_event& event,
+    const std::function<void ( KeyReport, KeyEvent )>& onEvent )
+{
     LOG ( DEBUG,
           "(event.type, event.value, event.code) = ({}, {}, {})",
           event.type,
           event.value,
           event.code );
 
-    return true;
+    if ( event.type == EV_SYN && event.code == SYN_DROPPED ) {
+        LOG ( WARN, "Keyboard events were dropped, resynchronising key state" );
+        ++m_Drops;
+        m_Dropping = true;
+        m_Frame.clear();
+        // the keys of the frame so far were never passed on, so resync has to catch up on them
+        m_KeyReport = m_FrameReport;
+        m_Held = m_FrameHeld;
+        return;
+    }
+
+    if ( event.type == EV_SYN && event.code == SYN_REPORT ) {
+        // everything up to the end of a dropped frame is incomplete, so ask the kernel instead
+        if ( m_Dropping ) {
+            m_Dropping = false;
+            resync ( keyTime ( event ) );
+        }
+        endFrame ( onEvent );
+        return;
+    }
+
+    if ( m_Dropping ) {
+        return;
+    }
+
+    updateKeyState ( event );  // process the captured event
+    if ( m_KeyEvent.code != m_KeyTable->keyRelease() ) {
+        m_Frame.push_back ( m_KeyEvent );
+    }
+}
+
+void hemiola::KeyboardEvents::endFrame (
+    const std::function<void ( KeyReport, KeyEvent )>& onEvent )
+{
+    // every key in the frame sees the report for the whole frame, so the host only needs the
+    // first of them
+    for ( const auto& key : m_Frame ) {
+        onEvent ( m_KeyReport, key );
+    }
+    m_Frame.clear();
+    m_FrameReport = m_KeyReport;
+    m_FrameHeld = m_Held;
+}
+
+void hemiola::KeyboardEvents::resync ( const KeyEvent::TimePoint time )
+{
+    const auto state = m_InputHID->keyState();
+
+    // rebuild the report in key code order, which is as good as any as the real order is lost
+    KeyReport report;
+    InputHID::KeyState held;
+    for ( std::size_t key = 0; key < state.size(); ++key ) {
+        if ( !state [key] ) {
+            continue;
+        }
+
+        const auto scanCode = static_cast<unsigned int> ( key );
+        if ( m_KeyTable->isScanModifier ( scanCode ) ) {
+            report.setModifier ( m_KeyTable->modToHex ( scanCode ) );
+            held.set ( key );
+        } else if ( m_KeyTable->isKeyValid ( scanCode ) ) {
+            report.setKey ( m_KeyTable->scanToHex ( scanCode ) );
+            held.set ( key );
+        }
+    }
+
+    // releases go first, so that nothing looks held for longer than it was
+    for ( std::size_t key = 0; key < held.size(); ++key ) {
+        if ( m_Held [key] && !held [key] ) {
+            m_Frame.push_back ( KeyEvent { static_cast<unsigned int> ( key ), false, time } );
+        }
+    }
+    for ( std::size_t key = 0; key < held.size(); ++key ) {
+        if ( !m_Held [key] && held [key] ) {
+            m_Frame.push_back ( KeyEvent { static_cast<unsigned int> ( key ), true, time } );
+        }
+    }
+
+    m_KeyReport = report;
+    m_Held = held;
+}
+
+std::size_t hemiola::KeyboardEvents::getEvents()
+{
+    try {
+        return m_InputHID->read ( m_Events.data(), m_Events.size() );
+    } catch ( ... ) {
+        LOG ( ERROR, "Connection to keyboard seems to have been lost while updating key state" );
+        throw;
+    }
+}
+
+KeyEvent::TimePoint hemiola::KeyboardEvents::keyTime ( const input_event& event ) const
+{
+    if ( !m_InputHID->monotonicTime() ) {
+        return KeyEvent::TimePoint {};
+    }
+
+    using namespace std::chrono;
+    return KeyEvent::TimePoint { duration_cast<KeyEvent::TimePoint::duration> (
+        seconds ( event.input_event_sec ) + microseconds ( event.input_event_usec ) ) };
 }
 
 void hemiola::KeyboardEvents::updateKeyState ( const input_event& event )
 {
     // reset our key
-    m_KeyRep = m_KeyTable->keyRelease();
+    m_KeyEvent = KeyEvent { m_KeyTable->keyRelease(), false };
 
     if ( event.type != EV_KEY ) {
         return;  // keyboard events are always of type EV_KEY
@@ -91,6 +212,7 @@ void hemiola::KeyboardEvents::updateKeyState ( const input_event& event )
     if ( event.value == EV_REPEAT ) {
         return;
     } else if ( event.value == EV_BREAK ) {
+        const auto before = m_KeyReport;
         // we need to check if the key is a modifier first for this to work correctly
         if ( m_KeyTable->isScanModifier ( scanCode ) ) {  // turn off the current modifier
             const auto scanHex { m_KeyTable->modToHex ( scanCode ) };
@@ -99,7 +221,12 @@ void hemiola::KeyboardEvents::updateKeyState ( const input_event& event )
             const auto scanHex { m_KeyTable->scanToHex ( scanCode ) };
             m_KeyReport.unsetKey ( scanHex );
         }
-        m_KeyRep = scanCode;
+
+        // only keys which are held in the report are released
+        if ( !( m_KeyReport == before ) ) {
+            m_KeyEvent = KeyEvent { scanCode, false, keyTime ( event ) };
+            m_Held [scanCode] = false;
+        }
 
         return;
     }
@@ -118,7 +245,8 @@ void hemiola::KeyboardEvents::updateKeyState ( const input_event& event )
               m_KeyTable->modToHex ( scanCode ) );
         const auto scanHex { m_KeyTable->modToHex ( scanCode ) };
         m_KeyReport.setModifier ( scanHex );
-        m_KeyRep = scanCode;
+        m_KeyEvent = KeyEvent { scanCode, true, keyTime ( event ) };
+        m_Held [scanCode] = true;
     } else if ( m_KeyTable->isKeyValid ( scanCode ) ) {
         const auto scanHex { m_KeyTable->scanToHex ( scanCode ) };
         LOG ( DEBUG,
@@ -126,8 +254,9 @@ void hemiola::KeyboardEvents::updateKeyState ( const input_event& event )
               m_KeyTable->charKeys ( scanCode ),
               scanCode,
               scanHex );
-        if ( !m_KeyReport.setKey ( scanHex ) ) {
-            m_KeyRep = scanCode;
-        }
+        // keys beyond the six boot protocol slots are still held, in the report's rollover
+        m_KeyReport.setKey ( scanHex );
+        m_KeyEvent = KeyEvent { scanCode, true, keyTime ( event ) };
+        m_Held [scanCode] = true;
     }
 }
@@ -0,0 +1,232 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "KeyboardFinder.h"
+
+#include "Exceptions.h"
+#include "Logger.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <utility>
+
+using namespace hemiola;
+
+// keys every keyboard has, and which other devices sending key events, e.g. power buttons or
+// mice, don't
+const static std::array<unsigned int, 5> REQUIRED_KEYS { KEY_ESC, KEY_1, KEY_2, KEY_A, KEY_Z };
+
+const static std::string EVENT_PREFIX { "event" };
+
+/*!
+ * @brief closes a file descriptor when it goes out of scope
+ */
+class Descriptor
+{
+public:
+    explicit Descriptor ( const int fd )
+        : m_Fd { fd }
+    {}
+    Descriptor ( const Descriptor& ) = delete;
+    Descriptor ( Descriptor&& ) = delete;
+    Descriptor& operator= ( const Descriptor& ) = delete;
+    Descriptor& operator= ( Descriptor&& ) = delete;
+    ~Descriptor()
+    {
+        if ( m_Fd != -1 ) {
+            ::close ( m_Fd );
+        }
+    }
+
+    int get() const { return m_Fd; }
+
+private:
+    int m_Fd;
+};
+
+/*!
+ * @brief whether one event device is numbered lower than another, e.g. event9 before event10
+ */
+static bool lowerNumbered ( const std::string& path, const std::string& other )
+{
+    return path.size() < other.size() || ( path.size() == other.size() && path < other );
+}
+
+std::optional<DeviceInfo> hemiola::DeviceProbe::probe ( const std::string& path ) const
+{
+    const Descriptor fd ( ::open ( path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC ) );
+    if ( fd.get() == -1 ) {
+        LOG ( DEBUG, "Unable to open {}: {}", path, errno );
+        return std::nullopt;
+    }
+
+    unsigned long types = 0;
+    if ( ioctl ( fd.get(), EVIOCGBIT ( 0, sizeof ( types ) ), &types ) == -1
+         || ( types & ( 1ul << EV_KEY ) ) == 0 ) {
+        return std::nullopt;
+    }
+
+    std::array<uint8_t, ( KEY_CNT + 7 ) / 8> bits {};
+    if ( ioctl ( fd.get(), EVIOCGBIT ( EV_KEY, bits.size() ), bits.data() ) == -1 ) {
+        return std::nullopt;
+    }
+
+    DeviceInfo info;
+    for ( std::size_t key = 0; key < info.keys.size(); ++key ) {
+        info.keys [key] = ( bits [key / 8] & ( 1u << ( key % 8 ) ) ) != 0;
+    }
+
+    std::array<char, 256> name {};
+    if ( ioctl ( fd.get(), EVIOCGNAME ( name.size() - 1 ), name.data() ) >= 0 ) {
+        info.name = name.data();
+    }
+
+    input_id id {};
+    if ( ioctl ( fd.get(), EVIOCGID, &id ) >= 0 ) {
+        info.bus = id.bustype;
+        info.vendor = id.vendor;
+    }
+
+    return info;
+}
+
+hemiola::KeyboardFinder::KeyboardFinder ( const std::string& devRoot,
+                                          std::shared_ptr<DeviceProbe> probe )
+    : m_DevRoot { devRoot }
+    , m_Probe { std::move ( probe ) }
+{
+    if ( !m_DevRoot.empty() && m_DevRoot.back() != '/' ) {
+        m_DevRoot += '/';
+    }
+}
+
+std::string hemiola::KeyboardFinder::find() const
+{
+    const auto devices = scan();
+
+    // ties go to the lowest numbered device, so the choice doesn't depend on listing order
+    const auto best = std::max_element (
+        devices.begin(), devices.end(), [] ( const auto& lhs, const auto& rhs ) {
+            return lhs.second < rhs.second;
+        } );
+    if ( best == devices.end() ) {
+        LOG ( ERROR,
+              "Please post the output of evtest as a new bug report.\n"
+              "github.com/erichlf/hemiola" );
+        throw KeyboardException ( "Couldn't determine keyboard." );
+    }
+
+    LOG ( INFO, "Found device: {}", best->first );
+    return best->first;
+}
+
+std::vector<std::string> hemiola::KeyboardFinder::findAll() const
+{
+    std::vector<std::string> keyboards;
+    for ( auto& device : scan() ) {
+        keyboards.push_back ( std::move ( device.first ) );
+    }
+    return keyboards;
+}
+
+bool hemiola::KeyboardFinder::isKeyboard ( const std::string& path ) const
+{
+    const auto info = m_Probe->probe ( path );
+    return info && score ( *info ) > 0;
+}
+
+bool hemiola::KeyboardFinder::isEventDevice ( const std::string& file )
+{
+    return file.compare ( 0, EVENT_PREFIX.size(), EVENT_PREFIX ) == 0;
+}
+
+std::vector<std::pair<std::string, std::size_t>> hemiola::KeyboardFinder::scan() const
+{
+    DIR* dir = opendir ( m_DevRoot.c_str() );
+    if ( dir == nullptr ) {
+        throw KeyboardException ( "Unable to list input devices in " + m_DevRoot );
+    }
+
+    std::vector<std::pair<std::string, std::size_t>> devices;
+    while ( const auto* entry = readdir ( dir ) ) {
+        const std::string file { entry->d_name };
+        if ( !isEventDevice ( file ) ) {
+            continue;
+        }
+
+        const auto path = m_DevRoot + file;
+        const auto info = m_Probe->probe ( path );
+        if ( !info ) {
+            continue;
+        }
+
+        const auto deviceScore = score ( *info );
+        LOG ( DEBUG,
+              "Device {} ({}, bus {:#x} vendor {:#x}) scored {}",
+              path,
+              info->name,
+              info->bus,
+              info->vendor,
+              deviceScore );
+        if ( deviceScore > 0 ) {
+            devices.emplace_back ( path, deviceScore );
+        }
+    }
+    closedir ( dir );
+
+    std::sort ( devices.begin(), devices.end(), [] ( const auto& lhs, const auto& rhs ) {
+        return lowerNumbered ( lhs.first, rhs.first );
+    } );
+    return devices;
+}
+
+std::size_t hemiola::KeyboardFinder::score ( const DeviceInfo& info )
+{
+    for ( const auto key : REQUIRED_KEYS ) {
+        if ( !info.keys [key] ) {
+            return 0;
+        }
+    }
+
+    std::size_t score = info.keys.count();
+
+    auto name = info.name;
+    std::transform ( name.begin(), name.end(), name.begin(), [] ( const unsigned char c ) {
+        return static_cast<char> ( std::tolower ( c ) );
+    } );
+    if ( name.find ( "keyboard" ) != std::string::npos ) {
+        score += 100;
+    }
+
+    // virtual keyboards, e.g. those made by macro tools with uinput, send every key but aren't
+    // what is typed on, whatever they call themselves
+    if ( info.bus != BUS_VIRTUAL && info.vendor != 0 ) {
+        score += 200;
+    }
+
+    return score;
+}
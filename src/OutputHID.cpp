@@ -20,16 +20,17 @@
 #include "OutputHID.h"
 
 #include "Exceptions.h"
+#include "KeyReport.h"
 #include "KeyboardEvents.h"
 #include "Logger.h"
 
 #include <fcntl.h>
-#include <fmt/ranges.h>
 #include <linux/input.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include <cassert>
-#include <vector>
+#include <cerrno>
 
 using namespace hemiola;
 
@@ -42,5 +43,39 @@ hemiola::OutputHID::~OutputHID()
 
 void hemiola::OutputHID::open()
 {
-    HID::open ( O_WRONLY | O_SYNC );
+    // writes never block, so a host which stops polling can't hold up whoever is writing
+    HID::open ( O_WRONLY | O_NONBLOCK );
+}
+
+void hemiola::OutputHID::writeReports ( const ReportSpan& reports,
+                                        const bool bulk,
+                                        const TimePoint ) const
+{
+    for ( const auto& report : reports ) {
+        if ( bulk ) {
+            writeBulk ( report );
+        } else {
+            write ( report );
+        }
+    }
+}
+
+bool hemiola::OutputHID::tryWrite ( const KeyReport& report ) const
+{
+    write ( report );
+    return true;
+}
+
+bool hemiola::OutputHID::waitWritable ( const std::chrono::milliseconds timeout ) const
+{
+    if ( fd() == -1 ) {
+        return true;
+    }
+
+    pollfd device { fd(), POLLOUT, 0 };
+    const auto ready = ::poll ( &device, 1, static_cast<int> ( timeout.count() ) );
+    if ( ready == -1 && errno != EINTR ) {
+        throw IoException ( "Unable to wait for output device", errno );
+    }
+    return ready > 0;
 }
\ No newline at end of file
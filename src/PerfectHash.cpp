@@ -0,0 +1,145 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "PerfectHash.h"
+
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
+using namespace hemiola;
+
+// seeds tried before giving up, and displacements tried for each bucket with each seed
+const static uint64_t MAX_SEEDS { 64 };
+const static uint32_t MAX_DISPLACEMENT { 1u << 16 };
+
+/*!
+ * @brief base two logarithm of the smallest power of two which is at least count and minimum
+ */
+static unsigned int log2Ceil ( const std::size_t count, const std::size_t minimum )
+{
+    unsigned int bits = 0;
+    while ( ( std::size_t { 1 } << bits ) < std::max ( count, minimum ) ) {
+        ++bits;
+    }
+    return bits;
+}
+
+/*!
+ * @brief the seed of the given attempt, spread out so attempts hash differently
+ */
+static uint64_t seed ( const uint64_t attempt )
+{
+    auto seed = ( attempt + 1 ) * PerfectHash::MULTIPLIER;
+    seed = ( seed ^ ( seed >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+    seed = ( seed ^ ( seed >> 27 ) ) * 0x94d049bb133111ebull;
+    return seed ^ ( seed >> 31 );
+}
+
+/*!
+ * @brief place the chords with the given hash, the buckets with the most chords first as they
+ *        are the hardest to place
+ * @return the table, or nothing if a bucket's chords couldn't be moved to free slots
+ */
+static std::optional<PerfectTable> place ( const PerfectHash& hash,
+                                           const std::vector<PerfectSlot>& chords )
+{
+    std::vector<uint64_t> hashes;
+    std::vector<std::vector<std::size_t>> buckets ( hash.bucketCount() );
+    for ( std::size_t i = 0; i < chords.size(); ++i ) {
+        hashes.push_back ( hash.fold ( chords [i].chord ) );
+        buckets [hash.bucket ( hashes.back() )].push_back ( i );
+    }
+
+    std::vector<std::size_t> order ( buckets.size() );
+    std::iota ( order.begin(), order.end(), 0 );
+    std::stable_sort ( order.begin(), order.end(), [&buckets] ( const auto lhs, const auto rhs ) {
+        return buckets [lhs].size() > buckets [rhs].size();
+    } );
+
+    PerfectTable table { hash,
+                         std::vector<uint32_t> ( buckets.size(), 0 ),
+                         std::vector<PerfectSlot> ( hash.slotCount() ) };
+    std::vector<std::size_t> taken;
+    for ( const auto bucket : order ) {
+        const auto& members = buckets [bucket];
+        if ( members.empty() ) {
+            break;
+        }
+
+        bool placed = false;
+        for ( uint32_t displacement = 0; !placed && displacement < MAX_DISPLACEMENT;
+              ++displacement ) {
+            taken.clear();
+            placed = std::all_of (
+                members.begin(),
+                members.end(),
+                [&hash, &hashes, &table, &taken, displacement] ( const auto member ) {
+                    const auto slot = hash.slot ( hashes [member], displacement );
+                    const auto free = table.slots [slot].entry == PerfectSlot::FREE
+                                      && std::find ( taken.begin(), taken.end(), slot )
+                                             == taken.end();
+                    taken.push_back ( slot );
+                    return free;
+                } );
+            if ( placed ) {
+                table.displacements [bucket] = displacement;
+                for ( std::size_t i = 0; i < members.size(); ++i ) {
+                    table.slots [taken [i]] = chords [members [i]];
+                }
+            }
+        }
+
+        if ( !placed ) {
+            return std::nullopt;
+        }
+    }
+
+    return table;
+}
+
+PerfectTable hemiola::PerfectTable::build ( const std::vector<PerfectSlot>& chords )
+{
+    std::vector<KeyMask::Words> sorted;
+    for ( const auto& chord : chords ) {
+        if ( chord.chord == KeyMask::Words {} || chord.entry == PerfectSlot::FREE ) {
+            throw DictionaryException ( "Chords in a perfect hash table need keys and an entry" );
+        }
+        sorted.push_back ( chord.chord );
+    }
+    std::sort ( sorted.begin(), sorted.end() );
+    if ( std::adjacent_find ( sorted.begin(), sorted.end() ) != sorted.end() ) {
+        throw DictionaryException ( "Chords in a perfect hash table must all be different" );
+    }
+
+    // at most half full like the compiled dictionary, with around two chords per bucket
+    const auto slotBits = log2Ceil ( 2 * chords.size(), 8 );
+    const auto bucketBits = log2Ceil ( chords.size() / 2, 2 );
+    for ( uint64_t attempt = 0; attempt < MAX_SEEDS; ++attempt ) {
+        const PerfectHash hash { seed ( attempt ), 64 - bucketBits, 64 - slotBits };
+        auto table = place ( hash, chords );
+        if ( table ) {
+            return std::move ( *table );
+        }
+    }
+
+    throw DictionaryException ( "Unable to find a perfect hash for the chords" );
+}
@@ -0,0 +1,207 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Reactor.h"
+
+#include "Exceptions.h"
+#include "KeyReport.h"
+#include "Logger.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+
+using namespace hemiola;
+
+static void closeDescriptor ( int& fd )
+{
+    if ( fd != -1 ) {
+        ::close ( fd );
+        fd = -1;
+    }
+}
+
+/*!
+ * @brief arm a timer to fire at the given time, or disarm it if the time is TimePoint::max()
+ */
+static void setTimer ( const int fd, const Hemiola::TimePoint deadline )
+{
+    using namespace std::chrono;
+
+    itimerspec spec {};
+    if ( deadline != Hemiola::TimePoint::max() ) {
+        // steady_clock is CLOCK_MONOTONIC, so the deadline can be used as an absolute time
+        const auto since = deadline.time_since_epoch();
+        const auto sec = duration_cast<seconds> ( since );
+        spec.it_value.tv_sec = sec.count();
+        spec.it_value.tv_nsec = duration_cast<nanoseconds> ( since - sec ).count();
+        // a zero value would disarm the timer
+        if ( spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0 ) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+
+    if ( timerfd_settime ( fd, TFD_TIMER_ABSTIME, &spec, nullptr ) == -1 ) {
+        throw IoException ( "Unable to set timer", errno );
+    }
+}
+
+hemiola::Reactor::Reactor ( std::shared_ptr<KeyboardEvents> events,
+                            std::shared_ptr<InputHID> input,
+                            std::shared_ptr<Hemiola> hemiola,
+                            std::shared_ptr<BufferedOutputHID> output )
+    : m_Events { std::move ( events ) }
+    , m_Input { std::move ( input ) }
+    , m_Hemiola { std::move ( hemiola ) }
+    , m_Output { std::move ( output ) }
+    , m_EpollId { epoll_create1 ( EPOLL_CLOEXEC ) }
+    , m_TimerId { timerfd_create ( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) }
+    , m_StopId { eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC ) }
+    , m_PaceId { timerfd_create ( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) }
+    , m_WatchingOutput { false }
+    , m_Pacing { false }
+{
+    if ( m_EpollId == -1 || m_TimerId == -1 || m_StopId == -1 || m_PaceId == -1 ) {
+        const auto error = errno;
+        closeDescriptor ( m_EpollId );
+        closeDescriptor ( m_TimerId );
+        closeDescriptor ( m_StopId );
+        closeDescriptor ( m_PaceId );
+        throw IoException ( "Unable to create reactor file descriptors", error );
+    }
+}
+
+hemiola::Reactor::~Reactor()
+{
+    closeDescriptor ( m_EpollId );
+    closeDescriptor ( m_TimerId );
+    closeDescriptor ( m_StopId );
+    closeDescriptor ( m_PaceId );
+}
+
+void hemiola::Reactor::run()
+{
+    watch ( m_Input->fd(), EPOLLIN );
+    watch ( m_TimerId, EPOLLIN );
+    watch ( m_StopId, EPOLLIN );
+    watch ( m_PaceId, EPOLLIN );
+    // the output is only watched once there is something to write
+    watch ( m_Output->fd(), 0 );
+
+    auto onEvent = [this] ( KeyReport report, KeyEvent key ) {
+        m_Hemiola->addEvent ( report, key );
+    };
+
+    LOG ( INFO, "Starting reactor" );
+    std::array<epoll_event, 4> ready {};
+    bool running = true;
+    while ( running ) {
+        armTimer();
+        updateOutputInterest();
+
+        const auto count = epoll_wait ( m_EpollId, ready.data(), ready.size(), -1 );
+        if ( count == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            throw IoException ( "Unable to wait for events", errno );
+        }
+
+        for ( int i = 0; i < count; ++i ) {
+            const auto fd = ready [i].data.fd;
+            if ( fd == m_Input->fd() ) {
+                m_Events->captureEvents ( onEvent );
+            } else if ( fd == m_TimerId ) {
+                uint64_t expirations = 0;
+                // nothing to do if the timer was rearmed before we got to read it
+                if ( ::read ( m_TimerId, &expirations, sizeof ( expirations ) ) > 0 ) {
+                    m_Hemiola->poll ( std::chrono::steady_clock::now() );
+                }
+            } else if ( fd == m_Output->fd() ) {
+                if ( m_Output->pending() ) {
+                    m_Output->flush();
+                }
+            } else if ( fd == m_PaceId ) {
+                // the host has had time to poll, the output is watched again on the next pass
+                uint64_t expirations = 0;
+                if ( ::read ( m_PaceId, &expirations, sizeof ( expirations ) ) > 0 ) {
+                    m_Pacing = false;
+                }
+            } else if ( fd == m_StopId ) {
+                running = false;
+            }
+        }
+    }
+
+    LOG ( INFO, "Reactor stopped" );
+}
+
+void hemiola::Reactor::stop()
+{
+    const uint64_t value = 1;
+    if ( ::write ( m_StopId, &value, sizeof ( value ) ) <= 0 ) {
+        LOG ( ERROR, "Unable to wake reactor: {}", errno );
+    }
+}
+
+void hemiola::Reactor::watch ( const int fd, const unsigned int events )
+{
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd;
+    if ( epoll_ctl ( m_EpollId, EPOLL_CTL_ADD, fd, &event ) == -1 ) {
+        throw IoException ( "Unable to watch file descriptor", errno );
+    }
+}
+
+void hemiola::Reactor::armTimer()
+{
+    setTimer ( m_TimerId, m_Hemiola->deadline() );
+}
+
+void hemiola::Reactor::updateOutputInterest()
+{
+    // reports written before the host's next poll would be merged with the one before, so wait
+    // for the pacing timer before watching for the output being writable
+    const bool paced = m_Output->pending()
+                       && m_Output->nextWrite() > std::chrono::steady_clock::now();
+    if ( paced != m_Pacing ) {
+        m_Pacing = paced;
+        setTimer ( m_PaceId, paced ? m_Output->nextWrite() : Hemiola::TimePoint::max() );
+    }
+
+    const bool writable = m_Output->pending() && !paced;
+    if ( writable == m_WatchingOutput ) {
+        return;
+    }
+
+    m_WatchingOutput = writable;
+    epoll_event event {};
+    event.events = m_WatchingOutput ? static_cast<uint32_t> ( EPOLLOUT ) : 0u;
+    event.data.fd = m_Output->fd();
+    if ( epoll_ctl ( m_EpollId, EPOLL_CTL_MOD, m_Output->fd(), &event ) == -1 ) {
+        throw IoException ( "Unable to update output interest", errno );
+    }
+}
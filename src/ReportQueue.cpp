@@ -0,0 +1,105 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "ReportQueue.h"
+
+#include "KeyMask.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace hemiola;
+
+// usage id of left control, modifier bit i of a report is the key with usage id MODIFIER_USAGE + i
+const static unsigned int MODIFIER_USAGE { 0xe0 };
+
+/*!
+ * @brief the keys and modifiers held in a report, by usage id
+ */
+static KeyMask held ( const KeyReport& report )
+{
+    KeyMask keys;
+    keys.words = report.held();
+    for ( unsigned int bit = 0; bit < 8; ++bit ) {
+        if ( ( report.modifiers & ( 1u << bit ) ) != 0 ) {
+            keys.set ( MODIFIER_USAGE + bit );
+        }
+    }
+    return keys;
+}
+
+hemiola::ReportQueue::ReportQueue ( const std::size_t capacity )
+    : m_Entries {}
+    , m_Capacity { std::max<std::size_t> ( capacity, 2 ) }
+    , m_Coalesced { 0 }
+    , m_Dropped { 0 }
+{}
+
+void hemiola::ReportQueue::push ( const KeyReport& report,
+                                  const TimePoint since,
+                                  const bool bulk )
+{
+    m_Entries.push_back ( Entry { report, since, bulk } );
+    if ( m_Entries.size() <= m_Capacity ) {
+        return;
+    }
+
+    coalesce();
+    if ( m_Entries.size() <= m_Capacity ) {
+        return;
+    }
+
+    // nothing could be coalesced, so give up on everything between the oldest report, which may
+    // be being written, and the newest, which is the state the host should end up in
+    const auto dropped = m_Entries.size() - 2;
+    LOG ( WARN, "Output device isn't being read, dropping {} reports", dropped );
+    m_Entries.back().since = m_Entries [1].since;
+    m_Entries.erase ( m_Entries.begin() + 1, m_Entries.end() - 1 );
+    m_Dropped += dropped;
+}
+
+void hemiola::ReportQueue::coalesce()
+{
+    assert ( m_Entries.size() > 2 );
+
+    // the front is never removed, so each report is compared with the one kept before it
+    std::size_t kept = 0;
+    std::size_t removed = 0;
+    for ( std::size_t i = 1; i + 1 < m_Entries.size(); ++i ) {
+        const auto before = held ( m_Entries [kept].report );
+        const auto current = held ( m_Entries [i].report );
+        const auto after = held ( m_Entries [i + 1].report );
+
+        // safe if the keys this report presses are still held after it, and it doesn't release a
+        // key which is pressed again after it
+        if ( after.contains ( current - before ) && current.contains ( before & after ) ) {
+            // the report after it now carries its changes, so it has been waiting as long
+            m_Entries [i + 1].since = m_Entries [i].since;
+            ++removed;
+        } else {
+            m_Entries [++kept] = m_Entries [i];
+        }
+    }
+    m_Entries [++kept] = m_Entries.back();
+    m_Entries.resize ( kept + 1 );
+
+    LOG ( DEBUG, "Coalesced {} queued reports", removed );
+    m_Coalesced += removed;
+}
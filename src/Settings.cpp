@@ -0,0 +1,81 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Settings.h"
+
+#include "Logger.h"
+
+#include <yaml-cpp/yaml.h>
+
+#include <utility>
+
+using namespace hemiola;
+
+const static std::string CONFIG { "config/settings.yml" };
+
+/*!
+ * @brief read a duration, in the units of Duration, if it is present in the settings
+ */
+template <typename Duration>
+static void loadDuration ( const YAML::Node& config, const std::string& name, Duration& value )
+{
+    if ( config [name] ) {
+        value = Duration ( config [name].as<unsigned int>() );
+    }
+}
+
+Settings hemiola::Settings::load()
+{
+    return load ( CONFIG );
+}
+
+Settings hemiola::Settings::load ( const std::string& configFile )
+{
+    const auto config = YAML::LoadFile ( configFile );
+
+    Settings settings;
+    loadDuration ( config, "chord_threshold_ms", settings.chordThreshold );
+    loadDuration ( config, "min_chord_threshold_ms", settings.minChordThreshold );
+    loadDuration ( config, "max_chord_threshold_ms", settings.maxChordThreshold );
+
+    loadDuration ( config, "max_hold_ms", settings.maxHold );
+    loadDuration ( config, "report_interval_us", settings.reportInterval );
+
+    if ( config ["adaptive_threshold"] ) {
+        settings.adaptiveThreshold = config ["adaptive_threshold"].as<bool>();
+    }
+
+    if ( config ["hold_back"] ) {
+        settings.holdBack = config ["hold_back"].as<bool>();
+    }
+
+    if ( config ["nkro"] ) {
+        settings.nkro = config ["nkro"].as<bool>();
+    }
+
+    if ( settings.minChordThreshold > settings.maxChordThreshold ) {
+        LOG ( WARN,
+              "min_chord_threshold_ms ({}) is larger than max_chord_threshold_ms ({})",
+              settings.minChordThreshold.count(),
+              settings.maxChordThreshold.count() );
+        std::swap ( settings.minChordThreshold, settings.maxChordThreshold );
+    }
+
+    return settings;
+}
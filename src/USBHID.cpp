@@ -24,36 +24,80 @@
 #include "Logger.h"
 
 #include <fcntl.h>
-#include <fmt/ranges.h>
 #include <linux/input.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
-#include <vector>
+#include <cerrno>
 
 using namespace hemiola;
 
-hemiola::USBHID::USBHID ( const std::string& device )
+hemiola::USBHID::USBHID ( const std::string& device, const ReportFormat format )
     : OutputHID ( device )
+    , m_Format { format }
 {}
 
 hemiola::USBHID::~USBHID()
 {
-    // make sure all key presses are released
-    write ( KeyReport {} );
+    // make sure all key presses are released, unless the host isn't listening anymore
+    try {
+        if ( m_Opened && !tryWrite ( KeyReport {} ) ) {
+            LOG ( WARN, "Output device not ready, keys may be left held down" );
+        }
+    } catch ( const IoException& exc ) {
+        LOG ( ERROR, "Unable to release keys: {}, {}", exc.what(), exc.code() );
+    }
 }
 
 void hemiola::USBHID::write ( const KeyReport& report ) const
+{
+    while ( !tryWrite ( report ) ) {
+        if ( !waitWritable ( WRITE_TIMEOUT ) ) {
+            throw IoException ( "Timed out writing to output device", ETIMEDOUT );
+        }
+    }
+}
+
+bool hemiola::USBHID::tryWrite ( const KeyReport& report ) const
 {
     assert ( m_Opened );
 
-    LOG ( DEBUG, "Sending Report: {}, ({})", report.modifiers, fmt::join ( report.keys, ", " ) );
-    const auto data = std::vector<uint8_t> { report.modifiers, 0x00,
-                                             report.keys [0],  report.keys [1],
-                                             report.keys [2],  report.keys [3],
-                                             report.keys [4],  report.keys [5] };
+    ReportData data;
+    const auto size = encode ( report, m_Format, data );
+    auto written = ::write ( m_HIDId, data.data(), size );
+    while ( written == -1 && errno == EINTR ) {
+        written = ::write ( m_HIDId, data.data(), size );
+    }
+
+    if ( written == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+        return false;
+    }
 
-    if ( ::write ( m_HIDId, data.data(), sizeof ( uint8_t ) * data.size() ) <= 0 ) {
-        throw IoException ( "Unable to write to output device", errno );
+    // a report is written whole or not at all, so anything else is an error
+    if ( written != static_cast<ssize_t> ( size ) ) {
+        throw IoException ( "Unable to write to output device", written == -1 ? errno : EIO );
     }
+    return true;
 }
+
+std::size_t hemiola::USBHID::encode ( const KeyReport& report,
+                                      const ReportFormat format,
+                                      ReportData& data )
+{
+    data [0] = report.modifiers;
+    data [1] = 0x00;
+
+    if ( format == ReportFormat::BOOT ) {
+        // keys in rollover don't fit in a boot protocol report, so are left out
+        std::copy ( report.keys.begin(), report.keys.end(), data.begin() + 2 );
+        return BOOT_LENGTH;
+    }
+
+    // bit i of byte j is usage j * 8 + i, and each 64 bit word covers 8 of those bytes
+    const auto held = report.held();
+    for ( std::size_t byte = 0; byte < NKRO_LENGTH - 2; ++byte ) {
+        data [byte + 2] = static_cast<uint8_t> ( held [byte / 8] >> ( ( byte % 8 ) * 8 ) );
+    }
+    return NKRO_LENGTH;
+}
\ No newline at end of file
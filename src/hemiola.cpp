@@ -19,13 +19,21 @@
 */
 #include "Hemiola.h"
 
+#include "AsyncOutputHID.h"
+#include "BufferedOutputHID.h"
+#include "ChordTiming.h"
+#include "EventQueue.h"
 #include "Exceptions.h"
+#include "InputManager.h"
 #include "KeyTable.h"
-#include "Keyboard.h"
 #include "KeyboardEvents.h"
+#include "LatencyStats.h"
 #include "Logger.h"
+#include "Reactor.h"
+#include "Settings.h"
 #include "USBHID.h"
 
+#include <chrono>
 #include <csignal>
 #include <cstdint>
 #include <exception>
@@ -55,7 +63,80 @@ static void signalHandler ( int sig )
     abort();
 }
 
-int main()
+static void logLatency ( const std::string& description, const hemiola::LatencyStats& latency )
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    LOG ( INFO,
+          "{} latency over {} reports: mean {}us, min {}us, max {}us",
+          description,
+          latency.count,
+          duration_cast<microseconds> ( latency.mean() ).count(),
+          latency.count == 0 ? 0 : duration_cast<microseconds> ( latency.min ).count(),
+          duration_cast<microseconds> ( latency.max ).count() );
+}
+
+static void logQueue ( const hemiola::EventQueue& queue )
+{
+    LOG ( INFO,
+          "Event queue high water mark {} of {} events, full {} times",
+          queue.highWater(),
+          hemiola::EventQueue::CAPACITY,
+          queue.overflows() );
+}
+
+static void logDrops ( const hemiola::KeyboardEvents& events )
+{
+    LOG ( INFO, "Keyboard events were dropped by the kernel {} times", events.drops() );
+}
+
+static void logRecovery ( const hemiola::InputManager& input )
+{
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+
+    const auto& recovery = input.recovery();
+    LOG ( INFO,
+          "Keyboards replugged {} times, recovering in mean {}ms, max {}ms",
+          recovery.count,
+          duration_cast<milliseconds> ( recovery.mean() ).count(),
+          duration_cast<milliseconds> ( recovery.max ).count() );
+}
+
+static void logTiming ( const hemiola::ChordTiming& timing )
+{
+    const auto& thresholds = timing.thresholds();
+    for ( std::size_t i = 0; i < thresholds.size(); ++i ) {
+        const auto& gaps = timing.chordGaps() [i];
+        LOG ( INFO,
+              "Chord threshold after {} keys: {}ms (from {} gaps, mean {:.1f}ms)",
+              i + 1,
+              thresholds [i].count(),
+              gaps.count,
+              gaps.mean );
+    }
+    LOG ( INFO,
+          "Typing gap over {} keys: mean {:.1f}ms",
+          timing.typingGaps().count,
+          timing.typingGaps().mean );
+}
+
+static void logSummary ( const hemiola::LatencyStats& latency,
+                         const double charactersPerSecond,
+                         hemiola::Hemiola& hemiola,
+                         const hemiola::KeyboardEvents& events,
+                         const hemiola::InputManager& input )
+{
+    logLatency ( "Event to report", latency );
+    logLatency ( "Kernel to processing", hemiola.inputDelay() );
+    LOG ( INFO, "Chords typed out at {:.1f} characters per second", charactersPerSecond );
+    logDrops ( events );
+    logRecovery ( input );
+    logTiming ( hemiola.timing() );
+}
+
+int main ( int argc, char* argv [] )
 try {
     signal ( SIGSEGV, signalHandler );
     signal ( SIGBUS, signalHandler );
@@ -64,47 +145,110 @@ try {
     signal ( SIGFPE, signalHandler );
 
     using namespace hemiola;
-    std::unique_lock lock ( mutex );
 
-    auto input = std::make_shared<Keyboard>();
-    auto output = std::make_shared<USBHID>();
+    // run capture, chord timing and output from a single epoll loop instead of one thread each
+    const bool useReactor = argc > 1 && std::string ( argv [1] ) == "--reactor";
+
+    const auto settings = Settings::load();
+    // every keyboard plugged in is read from, and they can be unplugged and plugged back in
+    auto input = std::make_shared<InputManager>();
+    auto output = std::make_shared<USBHID> (
+        "/dev/hidg0", settings.nkro ? ReportFormat::NKRO : ReportFormat::BOOT );
     auto keys = std::make_shared<KeyTable>();
     auto chords = std::make_shared<KeyChords> ( keys );
+    // the dictionary compiled by hemiola-dictc is mapped as is, saving parsing the settings
+    chords->load();
 
     // open devices so they can be used
     input->open();
     output->open();
 
-    Hemiola hemiola ( keys, chords, output );
-    hemiola.run();
+    auto eventHandler = std::make_shared<KeyboardEvents> ( keys, input );
+
+    if ( useReactor ) {
+        auto buffered = std::make_shared<BufferedOutputHID> ( output, settings.reportInterval );
+        auto hemiola = std::make_shared<Hemiola> ( keys, chords, buffered, settings );
+        Reactor reactor ( eventHandler, input, hemiola, buffered );
+        auto summary = [&] {
+            logSummary ( reactor.latency(),
+                         buffered->charactersPerSecond(),
+                         *hemiola,
+                         *eventHandler,
+                         *input );
+        };
+        try {
+            reactor.run();
+        } catch ( ... ) {
+            summary();
+            throw;
+        }
+        summary();
 
-    KeyboardEvents eventHandler ( keys, input );
+        return EXIT_SUCCESS;
+    }
+
+    std::unique_lock lock ( mutex );
+
+    // the output device is written from its own thread, so that a slow write never holds up
+    // the engine
+    auto asyncOutput = std::make_shared<AsyncOutputHID> ( output, settings.reportInterval );
+    Hemiola hemiola ( keys, chords, asyncOutput, settings );
+    hemiola.run();
 
     // the exception that will be thrown by keys
     std::exception_ptr e;
     auto onError = [&e] ( std::exception_ptr exc ) {
-        e = exc;
+        {
+            std::lock_guard<std::mutex> guard ( mutex );
+            e = exc;
+        }
         cv.notify_all();
     };
 
-    auto onEvent = [&hemiola, &onError, &output] ( KeyReport report, unsigned int keyRep ) {
-        LOG ( DEBUG, keyRep );
+    // events are handed from the capture thread to the engine thread through a lock free queue,
+    // so that reading the keyboard never waits on chord processing or the output device
+    EventQueue queue;
+
+    auto onEngineEvent = [&hemiola, &onError] ( const KeyReport& report, const KeyEvent& key ) {
         try {
-            output->write ( report );
-            hemiola.addKey ( keyRep );
+            hemiola.addEvent ( report, key );
         } catch ( ... ) {
             onError ( std::current_exception() );
         }
     };
 
+    auto engineThread = std::thread ( [&queue, &onEngineEvent] { queue.run ( onEngineEvent ); } );
+
+    auto onEvent = [&queue] ( KeyReport report, KeyEvent key ) { queue.push ( report, key ); };
+
     auto captureThread = std::thread ( [&eventHandler, &onEvent, &onError] {
-        eventHandler.capture ( std::ref ( onEvent ), std::ref ( onError ) );
+        eventHandler->capture ( std::ref ( onEvent ), std::ref ( onError ) );
         cv.notify_all();
     } );
 
-    // run until a signal is caught
-    cv.wait ( lock );
+    // run until capture or the engine fails, a spurious wake up isn't a reason to stop
+    cv.wait ( lock, [&e] { return e != nullptr; } );
+    lock.unlock();
+    // capture carries on through keyboards being unplugged, so it has to be told to stop when
+    // the engine is what failed
+    eventHandler->stop();
     captureThread.join();
+    queue.stop();
+    engineThread.join();
+    hemiola.stop();
+    try {
+        asyncOutput->stop();
+    } catch ( ... ) {
+        if ( e == nullptr ) {
+            e = std::current_exception();
+        }
+    }
+    logSummary ( asyncOutput->latency(),
+                 asyncOutput->charactersPerSecond(),
+                 hemiola,
+                 *eventHandler,
+                 *input );
+    logQueue ( queue );
 
     if ( e != nullptr ) {
         std::rethrow_exception ( e );
@@ -0,0 +1,64 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "KeyChords.h"
+#include "KeyTable.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/*!
+ * @brief compiles the chords in a settings file in to a dictionary which hemiola maps at start up
+ *        instead of parsing the settings file, usage:
+ *        hemiola-dictc [settings.yml [chords.bin]]
+ */
+int main ( int argc, char* argv [] )
+try {
+    using namespace hemiola;
+
+    if ( argc > 3 ) {
+        std::cerr << "Usage: " << argv [0] << " [settings.yml [chords.bin]]\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::string config = argc > 1 ? argv [1] : "config/settings.yml";
+    const std::string dictionary = argc > 2 ? argv [2] : "config/chords.bin";
+
+    KeyChords chords ( std::make_shared<KeyTable>() );
+    chords.buildMap ( config );
+    chords.saveImage ( dictionary );
+
+    // read it back, so a dictionary which can't be used is found now rather than at start up
+    KeyChords compiled ( std::make_shared<KeyTable>() );
+    compiled.loadImage ( dictionary );
+    std::cout << "Compiled " << compiled.reachable ( KeyMask {} ) << " chords from " << config
+              << " to " << dictionary << "\n";
+
+    return EXIT_SUCCESS;
+} catch ( const hemiola::CodedException& exc ) {
+    std::cerr << exc.what() << ": " << exc.code() << "\n";
+    return EXIT_FAILURE;
+} catch ( const std::exception& exc ) {
+    std::cerr << exc.what() << "\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,176 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "KeyChords.h"
+#include "KeyTable.h"
+#include "PerfectHash.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief write a constexpr array of the given type
+ * @param out where to write the array
+ * @param declaration the array's type and name
+ * @param count the number of elements
+ * @param element writes the element at an index
+ * @param perLine the number of elements on each line
+ */
+template <typename Element>
+static void writeArray ( std::ostream& out,
+                         const std::string& declaration,
+                         const std::size_t count,
+                         Element&& element,
+                         const std::size_t perLine )
+{
+    out << "    " << declaration << " [] = {";
+    for ( std::size_t i = 0; i < count; ++i ) {
+        out << ( i % perLine == 0 ? "\n        " : " " );
+        element ( i );
+        out << ",";
+    }
+    out << "\n    };\n\n";
+}
+
+/*!
+ * @brief write the header which compiles a dictionary in to hemiola
+ */
+static void writeHeader ( std::ostream& out,
+                          const std::string& config,
+                          const ChordImage& image,
+                          const PerfectTable& table )
+{
+    out << std::hex << std::setfill ( '0' );
+    out << "// Generated by hemiola-dictgen from " << config << ", do not edit\n"
+        << "#pragma once\n\n"
+        << "#include \"KeyMask.h\"\n"
+        << "#include \"PerfectHash.h\"\n\n"
+        << "#include <cstdint>\n\n"
+        << "namespace hemiola::builtin\n{\n";
+
+    out << "    constexpr PerfectHash HASH { 0x" << table.hash.seed << "ull, " << std::dec
+        << table.hash.bucketShift << ", " << table.hash.slotShift << " };\n\n"
+        << std::hex;
+
+    writeArray (
+        out,
+        "constexpr uint32_t DISPLACEMENTS",
+        table.displacements.size(),
+        [&out, &table] ( const auto i ) { out << "0x" << table.displacements [i]; },
+        8 );
+
+    writeArray (
+        out,
+        "constexpr PerfectSlot SLOTS",
+        table.slots.size(),
+        [&out, &table] ( const auto i ) {
+            const auto& slot = table.slots [i];
+            out << "{ {";
+            for ( const auto word : slot.chord ) {
+                out << " 0x" << word << "ull,";
+            }
+            out << " }, 0x" << slot.entry << " }";
+        },
+        1 );
+
+    // the compiled dictionary, used in place by ChordImage
+    writeArray (
+        out,
+        "alignas ( 8 ) constexpr uint8_t IMAGE",
+        image.header().size,
+        [&out, &image] ( const auto i ) {
+            out << "0x" << std::setw ( 2 ) << unsigned { image.data() [i] };
+        },
+        12 );
+
+    out << "    static_assert ( sizeof ( DISPLACEMENTS ) / sizeof ( DISPLACEMENTS [0] )\n"
+        << "                    == HASH.bucketCount() );\n"
+        << "    static_assert ( sizeof ( SLOTS ) / sizeof ( SLOTS [0] ) == HASH.slotCount() );\n\n"
+        << "    /*!\n"
+        << "     * @brief look up a chord in the dictionary\n"
+        << "     * @return the chord's slot, whose entry is the chord's slot in IMAGE, or nullptr\n"
+        << "     */\n"
+        << "    constexpr const PerfectSlot* find ( const KeyMask::Words& chord )\n"
+        << "    {\n"
+        << "        const auto& slot = SLOTS [HASH.find ( chord, DISPLACEMENTS )];\n"
+        << "        return slot.holds ( chord ) ? &slot : nullptr;\n"
+        << "    }\n"
+        << "}  // namespace hemiola::builtin\n";
+}
+
+/*!
+ * @brief generates a header with the chords in a settings file and a perfect hash of them, so
+ *        they can be compiled in to hemiola, usage:
+ *        hemiola-dictgen settings.yml BuiltinDictionary.h
+ * @note chords which clash are an error rather than being left out
+ */
+int main ( int argc, char* argv [] )
+try {
+    if ( argc != 3 ) {
+        std::cerr << "Usage: " << argv [0] << " settings.yml BuiltinDictionary.h\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::string config = argv [1];
+    const std::string header = argv [2];
+
+    KeyChords chords ( std::make_shared<KeyTable>() );
+    chords.buildMap ( config, true );
+
+    const auto& image = chords.image();
+    std::vector<PerfectSlot> entries;
+    for ( uint32_t slot = 0; slot < image.header().slotCount; ++slot ) {
+        if ( !image.chord ( slot ).empty() ) {
+            entries.push_back ( PerfectSlot { image.chord ( slot ).words, slot } );
+        }
+    }
+    const auto table = PerfectTable::build ( entries );
+
+    // only written once everything has succeeded, so a failed build doesn't leave a header behind
+    std::ostringstream text;
+    writeHeader ( text, config, image, table );
+    std::ofstream out ( header, std::ios::trunc );
+    out << text.str();
+    out.close();
+    if ( !out ) {
+        throw IoException ( "Unable to write " + header, errno );
+    }
+
+    std::cout << "Compiled " << entries.size() << " chords from " << config << " in to " << header
+              << "\n";
+    return EXIT_SUCCESS;
+} catch ( const hemiola::CodedException& exc ) {
+    std::cerr << exc.what() << ": " << exc.code() << "\n";
+    return EXIT_FAILURE;
+} catch ( const std::exception& exc ) {
+    std::cerr << exc.what() << "\n";
+    return EXIT_FAILURE;
+}
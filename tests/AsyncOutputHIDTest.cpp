@@ -0,0 +1,255 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "AsyncOutputHID.h"
+#include "Exceptions.h"
+#include "KeyReport.h"
+#include "OutputHID.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief output device recording what is written, which can be made to block until released
+ */
+class GatedOutputHID : public OutputHID
+{
+public:
+    GatedOutputHID() = default;
+    GatedOutputHID ( const GatedOutputHID& ) = delete;
+    GatedOutputHID ( GatedOutputHID&& ) = delete;
+    GatedOutputHID& operator= ( const GatedOutputHID& ) = delete;
+    GatedOutputHID& operator= ( GatedOutputHID&& ) = delete;
+    ~GatedOutputHID() = default;
+
+    void open() override
+    { /* no opt */
+    }
+
+    void write ( const KeyReport& report ) const override
+    {
+        std::unique_lock<std::mutex> lock ( m_Mutex );
+        m_Writing = true;
+        m_Changed.notify_all();
+        m_Changed.wait ( lock, [this] { return m_Open; } );
+
+        if ( m_Fail ) {
+            throw IoException ( "Unable to write", 5 );
+        }
+        m_Written.push_back ( report );
+        m_Changed.notify_all();
+    }
+
+    /*!
+     * @brief block writes until open is called
+     */
+    void close() override
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Open = false;
+    }
+
+    /*!
+     * @brief let writes through
+     */
+    void release()
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Open = true;
+        m_Changed.notify_all();
+    }
+
+    /*!
+     * @brief wait for a write to start
+     */
+    void waitForWrite()
+    {
+        std::unique_lock<std::mutex> lock ( m_Mutex );
+        m_Changed.wait ( lock, [this] { return m_Writing; } );
+    }
+
+    /*!
+     * @brief wait for the given number of reports to have been written
+     */
+    std::vector<KeyReport> waitForReports ( std::size_t count )
+    {
+        std::unique_lock<std::mutex> lock ( m_Mutex );
+        m_Changed.wait_for ( lock, std::chrono::seconds ( 5 ), [this, count] {
+            return m_Written.size() >= count;
+        } );
+        return m_Written;
+    }
+
+    void fail()
+    {
+        std::lock_guard<std::mutex> lock ( m_Mutex );
+        m_Fail = true;
+    }
+
+private:
+    mutable std::mutex m_Mutex;
+    mutable std::condition_variable m_Changed;
+    mutable std::vector<KeyReport> m_Written;
+    mutable bool m_Writing { false };
+    bool m_Open { true };
+    bool m_Fail { false };
+};
+
+/*!
+ * @brief output device which is never ready for a report and fails while being waited on, as
+ *        happens when the gadget goes away
+ */
+class UnpluggedOutputHID : public OutputHID
+{
+public:
+    UnpluggedOutputHID() = default;
+    UnpluggedOutputHID ( const UnpluggedOutputHID& ) = delete;
+    UnpluggedOutputHID ( UnpluggedOutputHID&& ) = delete;
+    UnpluggedOutputHID& operator= ( const UnpluggedOutputHID& ) = delete;
+    UnpluggedOutputHID& operator= ( UnpluggedOutputHID&& ) = delete;
+    ~UnpluggedOutputHID() = default;
+
+    void open() override
+    { /* no opt */
+    }
+
+    void write ( const KeyReport& ) const override {}
+
+    bool tryWrite ( const KeyReport& ) const override { return false; }
+
+    bool waitWritable ( const std::chrono::milliseconds ) const override
+    {
+        throw IoException ( "Unable to wait for output device", 19 );
+    }
+};
+
+/*!
+ * @brief a report with the given key held
+ */
+static KeyReport press ( uint8_t key )
+{
+    KeyReport report;
+    report.keys [0] = key;
+    return report;
+}
+
+TEST ( AsyncOutputHIDTest, orderTest )
+{
+    auto device = std::make_shared<GatedOutputHID>();
+    device->close();
+    AsyncOutputHID output ( device );
+
+    // hold the writer in the middle of typing out a word, then pass on a key from the keyboard
+    output.writeBulk ( press ( 0x04 ) );
+    device->waitForWrite();
+    output.writeBulk ( KeyReport {} );
+    output.writeBulk ( press ( 0x05 ) );
+    output.writeBulk ( KeyReport {} );
+    output.write ( press ( 0x1e ) );
+    output.write ( KeyReport {} );
+    output.writeBulk ( press ( 0x2a ) );
+    output.writeBulk ( KeyReport {} );
+    device->release();
+
+    // everything reaches the host in the order it was queued, so the key lands after the word
+    // and the edit after it, rather than in the middle of either
+    const auto written = device->waitForReports ( 8 );
+    const std::vector<KeyReport> expected { press ( 0x04 ), KeyReport {}, press ( 0x05 ),
+                                            KeyReport {},   press ( 0x1e ), KeyReport {},
+                                            press ( 0x2a ), KeyReport {} };
+    EXPECT_EQ ( written, expected );
+
+    output.stop();
+    EXPECT_EQ ( output.latency().count, 8u );
+}
+
+TEST ( AsyncOutputHIDTest, batchTest )
+{
+    auto device = std::make_shared<GatedOutputHID>();
+    AsyncOutputHID output ( device );
+
+    // a whole word is queued at once and written in order
+    const std::vector<KeyReport> word {
+        press ( 0x0b ), KeyReport {}, press ( 0x0c ), KeyReport {} };
+    output.writeReports (
+        ReportSpan { word.data(), word.size() }, true, std::chrono::steady_clock::now() );
+    EXPECT_EQ ( device->waitForReports ( word.size() ), word );
+
+    output.stop();
+    EXPECT_EQ ( output.latency().count, word.size() );
+}
+
+TEST ( AsyncOutputHIDTest, errorTest )
+{
+    auto device = std::make_shared<GatedOutputHID>();
+    device->fail();
+    AsyncOutputHID output ( device );
+
+    output.writeBulk ( press ( 0x04 ) );
+
+    // the writer's error is passed on by stop when nothing is written after it, and only once
+    EXPECT_THROW ( output.stop(), IoException );
+    EXPECT_NO_THROW ( output.stop() );
+    EXPECT_NO_THROW ( output.write ( KeyReport {} ) );
+
+    // a report which failed to be written wasn't typed out
+    EXPECT_EQ ( output.latency().count, 0u );
+    EXPECT_EQ ( output.charactersPerSecond(), 0.0 );
+}
+
+TEST ( AsyncOutputHIDTest, waitErrorTest )
+{
+    auto device = std::make_shared<UnpluggedOutputHID>();
+    AsyncOutputHID output ( device );
+
+    // the device going away while the writer waits for it doesn't take the writer down with it
+    output.write ( press ( 0x04 ) );
+    EXPECT_THROW ( output.stop(), IoException );
+    EXPECT_EQ ( output.latency().count, 0u );
+}
+
+TEST ( AsyncOutputHIDTest, pacingTest )
+{
+    using namespace std::chrono_literals;
+
+    auto device = std::make_shared<GatedOutputHID>();
+    AsyncOutputHID output ( device, 5ms );
+
+    // a word with a repeated letter, which the host would merge if it weren't paced
+    const auto start = std::chrono::steady_clock::now();
+    for ( const uint8_t key : { 0x0a, 0x12, 0x12, 0x07 } ) {
+        output.writeBulk ( press ( key ) );
+        output.writeBulk ( KeyReport {} );
+    }
+    EXPECT_EQ ( device->waitForReports ( 8 ).size(), 8u );
+    output.stop();
+
+    // every report after the first waits for the host's next poll
+    EXPECT_GE ( std::chrono::steady_clock::now() - start, 7 * 5ms );
+    EXPECT_GT ( output.charactersPerSecond(), 0.0 );
+    EXPECT_LE ( output.charactersPerSecond(), 4 / 0.035 );
+}
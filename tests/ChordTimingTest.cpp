@@ -0,0 +1,128 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "ChordTiming.h"
+#include "Settings.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace hemiola;
+using namespace std::chrono_literals;
+
+/*!
+ * @brief record count chords of the given size whose keys were each pressed gap apart
+ */
+static void addChords ( ChordTiming& timing,
+                        const std::size_t count,
+                        const std::size_t size,
+                        const std::chrono::milliseconds gap )
+{
+    const auto start = std::chrono::steady_clock::now();
+    for ( std::size_t i = 0; i < count; ++i ) {
+        std::vector<ChordTiming::TimePoint> presses;
+        for ( std::size_t key = 0; key < size; ++key ) {
+            presses.push_back ( start + static_cast<int> ( key ) * gap );
+        }
+        timing.addChord ( presses.data(), presses.size() );
+    }
+}
+
+TEST ( SettingsTest, loadTest )
+{
+    const auto path = ::testing::TempDir() + "SettingsTest.yml";
+    std::ofstream config ( path );
+    config << "chord_threshold_ms: 100\n"
+              "adaptive_threshold: true\n"
+              "min_chord_threshold_ms: 200\n"
+              "max_chord_threshold_ms: 20\n"
+              "report_interval_us: 125\n";
+    config.close();
+
+    const auto settings = Settings::load ( path );
+    EXPECT_EQ ( settings.chordThreshold, 100ms );
+    EXPECT_EQ ( settings.adaptiveThreshold, true );
+    // bounds given the wrong way around are swapped
+    EXPECT_EQ ( settings.minChordThreshold, 20ms );
+    EXPECT_EQ ( settings.maxChordThreshold, 200ms );
+    EXPECT_EQ ( settings.reportInterval, 125us );
+
+    // anything missing keeps its default
+    std::ofstream empty ( path );
+    empty << "dup: \"=\"\n";
+    empty.close();
+
+    const auto defaults = Settings::load ( path );
+    EXPECT_EQ ( defaults.chordThreshold, Settings {}.chordThreshold );
+    EXPECT_EQ ( defaults.adaptiveThreshold, false );
+
+    std::remove ( path.c_str() );
+}
+
+TEST ( ChordTimingTest, fixedThresholdTest )
+{
+    Settings settings;
+    settings.chordThreshold = 100ms;
+    ChordTiming timing ( settings );
+
+    addChords ( timing, 50, 3, 10ms );
+    EXPECT_EQ ( timing.threshold ( 1 ), 100ms );
+    EXPECT_EQ ( timing.threshold ( 2 ), 100ms );
+    // the statistics are still gathered for inspection
+    EXPECT_EQ ( timing.chordGaps() [0].count, 50u );
+    EXPECT_NEAR ( timing.chordGaps() [1].mean, 10.0, 0.01 );
+}
+
+TEST ( ChordTimingTest, adaptiveThresholdTest )
+{
+    Settings settings;
+    settings.chordThreshold = 100ms;
+    settings.adaptiveThreshold = true;
+    settings.minChordThreshold = 30ms;
+    settings.maxChordThreshold = 300ms;
+    ChordTiming timing ( settings );
+
+    // too few chords to learn from yet
+    addChords ( timing, 5, 2, 50ms );
+    EXPECT_EQ ( timing.threshold ( 1 ), 100ms );
+
+    // chords of two keys pressed 50ms apart only need a 50ms window after the first key
+    addChords ( timing, 50, 2, 50ms );
+    EXPECT_EQ ( timing.threshold ( 1 ), 50ms );
+    EXPECT_EQ ( timing.threshold ( 2 ), 100ms );
+
+    // and the window never exceeds the time it takes to type the next key
+    for ( int i = 0; i < 50; ++i ) {
+        timing.addTyping ( 40ms );
+    }
+    EXPECT_EQ ( timing.threshold ( 1 ), 40ms );
+
+    // but stays within the configured bounds
+    addChords ( timing, 200, 2, 5ms );
+    EXPECT_EQ ( timing.threshold ( 1 ), 30ms );
+    EXPECT_EQ ( timing.thresholds() [0], 30ms );
+
+    // sizes past the largest tracked share its threshold
+    EXPECT_EQ ( timing.threshold ( 100 ), timing.threshold ( ChordTiming::MAX_CHORD_SIZE ) );
+}
@@ -0,0 +1,93 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "EventQueue.h"
+#include "KeyEvent.h"
+#include "KeyReport.h"
+#include "SpscRing.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace hemiola;
+
+TEST ( SpscRingTest, pushPopTest )
+{
+    SpscRing<int, 4> ring;
+    int value = 0;
+    EXPECT_EQ ( ring.pop ( value ), false );
+
+    EXPECT_EQ ( ring.push ( 1 ), true );
+    EXPECT_EQ ( ring.push ( 2 ), true );
+    EXPECT_EQ ( ring.push ( 3 ), true );
+    EXPECT_EQ ( ring.push ( 4 ), true );
+    // the ring is full
+    EXPECT_EQ ( ring.push ( 5 ), false );
+    EXPECT_EQ ( ring.depth(), 4u );
+
+    EXPECT_EQ ( ring.pop ( value ), true );
+    EXPECT_EQ ( value, 1 );
+    EXPECT_EQ ( ring.push ( 5 ), true );
+
+    // items come out in order, across the wrap around
+    for ( const auto expected : { 2, 3, 4, 5 } ) {
+        EXPECT_EQ ( ring.pop ( value ), true );
+        EXPECT_EQ ( value, expected );
+    }
+    EXPECT_EQ ( ring.pop ( value ), false );
+    EXPECT_EQ ( ring.depth(), 0u );
+    EXPECT_EQ ( ring.highWater(), 4u );
+}
+
+TEST ( EventQueueTest, threadedTest )
+{
+    // many more events than fit in the queue, so the producer has to outrun the consumer at times
+    const unsigned int count = 50 * EventQueue::CAPACITY;
+
+    EventQueue queue;
+    std::vector<unsigned int> received;
+    received.reserve ( count );
+
+    auto consumer = std::thread ( [&queue, &received] {
+        queue.run ( [&received] ( const KeyReport& report, const KeyEvent& event ) {
+            EXPECT_EQ ( report.keys [0], event.code % 256 );
+            received.push_back ( event.code );
+        } );
+    } );
+
+    for ( unsigned int code = 0; code < count; ++code ) {
+        KeyReport report;
+        report.keys [0] = static_cast<uint8_t> ( code % 256 );
+        queue.push ( report, KeyEvent { code, true } );
+    }
+
+    // everything queued before stopping is still processed
+    queue.stop();
+    consumer.join();
+
+    ASSERT_EQ ( received.size(), count );
+    for ( unsigned int code = 0; code < count; ++code ) {
+        ASSERT_EQ ( received [code], code );
+    }
+    EXPECT_EQ ( queue.depth(), 0u );
+    EXPECT_GE ( queue.highWater(), 1u );
+    EXPECT_LE ( queue.highWater(), EventQueue::CAPACITY );
+}
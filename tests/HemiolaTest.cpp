@@ -19,15 +19,21 @@
 */
 #include "Hemiola.h"
 #include "KeyChords.h"
+#include "KeyEvent.h"
+#include "KeyMask.h"
 #include "KeyTable.h"
 #include "OutputHID.h"
+#include "Settings.h"
 
 #include <fmt/core.h>
 #include <fmt/ranges.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 class TestOutputHID : public hemiola::OutputHID
@@ -45,9 +51,12 @@ public:
     { /* no opt */
     }
 
-    void write ( const hemiola::KeyReport& /*report*/ ) const override
-    { /* no opt */
+    void write ( const hemiola::KeyReport& report ) const override
+    {
+        m_Written.push_back ( report );
     }
+
+    mutable std::vector<hemiola::KeyReport> m_Written;
 };
 
 class HemiolaTest : public ::testing::Test
@@ -55,22 +64,140 @@ class HemiolaTest : public ::testing::Test
 protected:
     void SetUp() override
     {
+        m_Config = ::testing::TempDir() + "HemiolaTest.yml";
+        std::ofstream config ( m_Config );
+        config << "chords:\n"
+                  "  because: bc\n"
+                  "  became: bcm\n"
+                  "  bus: bus\n";
+        config.close();
+
         m_KeyTable = std::make_shared<hemiola::KeyTable>();
         m_KeyChords = std::make_shared<hemiola::KeyChords> ( m_KeyTable );
+        m_KeyChords->buildMap ( m_Config );
         m_Output = std::make_shared<TestOutputHID>();
 
         m_Hemiola = std::make_shared<hemiola::Hemiola> ( m_KeyTable, m_KeyChords, m_Output );
     }
 
+    void TearDown() override { std::remove ( m_Config.c_str() ); }
+
 public:
-    void addKey ( unsigned int key ) { m_Hemiola->addKey ( key ); }
+    /*!
+     * @brief switch to holding back keys which could be part of a chord
+     */
+    void holdBack()
+    {
+        hemiola::Settings settings;
+        settings.holdBack = true;
+        m_Hemiola
+            = std::make_shared<hemiola::Hemiola> ( m_KeyTable, m_KeyChords, m_Output, settings );
+    }
+
+    /*!
+     * @brief press a key on the keyboard, sending its report through Hemiola
+     */
+    void pressKey ( unsigned int key )
+    {
+        if ( m_KeyTable->isModifier ( key ) ) {
+            m_Report.setModifier ( m_KeyTable->modToHex ( key ) );
+        } else {
+            m_Report.setKey ( m_KeyTable->scanToHex ( key ) );
+        }
+        m_Hemiola->addEvent ( m_Report, hemiola::KeyEvent { key, true } );
+    }
+
+    /*!
+     * @brief release a key on the keyboard, sending its report through Hemiola
+     */
+    void releaseKey ( unsigned int key )
+    {
+        if ( m_KeyTable->isModifier ( key ) ) {
+            m_Report.unsetModifier ( m_KeyTable->modToHex ( key ) );
+        } else {
+            m_Report.unsetKey ( m_KeyTable->scanToHex ( key ) );
+        }
+        m_Hemiola->addEvent ( m_Report, hemiola::KeyEvent { key, false } );
+    }
+
+    /*!
+     * @brief a report with only the given key held
+     */
+    hemiola::KeyReport typed ( unsigned int key )
+    {
+        hemiola::KeyReport report;
+        report.setKey ( m_KeyTable->scanToHex ( key ) );
+        return report;
+    }
+
+    void press ( unsigned int key ) { m_Hemiola->addKey ( hemiola::KeyEvent { key, true } ); }
+
+    void release ( unsigned int key ) { m_Hemiola->addKey ( hemiola::KeyEvent { key, false } ); }
+
+    /*!
+     * @brief press a key which the kernel saw at the given time
+     */
+    void pressAt ( unsigned int key, hemiola::Hemiola::TimePoint time )
+    {
+        m_Hemiola->addKey ( hemiola::KeyEvent { key, true, time } );
+    }
+
+    void tap ( unsigned int key )
+    {
+        press ( key );
+        release ( key );
+    }
+
+    void run() { m_Hemiola->run(); }
+
+    void stop() { m_Hemiola->stop(); }
 
-    const std::unordered_map<unsigned int, hemiola::Hemiola::TimePoint>& captured()
+    void poll ( hemiola::Hemiola::TimePoint now ) { m_Hemiola->poll ( now ); }
+
+    const hemiola::KeyMask& captured() { return m_Hemiola->captured(); }
+
+    const std::vector<hemiola::KeyReport>& written() { return m_Output->m_Written; }
+
+    /*!
+     * @brief the reports making up the word for the given chord
+     */
+    std::vector<hemiola::KeyReport> reports ( const std::vector<unsigned int>& keys )
     {
-        return m_Hemiola->captured();
+        hemiola::KeyMask mask;
+        for ( const auto key : keys ) {
+            mask.set ( key );
+        }
+
+        const auto span = m_KeyChords->reports ( *m_KeyChords->resolve ( mask ) );
+        return std::vector<hemiola::KeyReport> ( span.begin(), span.end() );
+    }
+
+    /*!
+     * @brief the reports correcting what was typed to the word for the given chord
+     * @param erase the number of typed characters which are backspaced
+     * @param keys the keys making up the chord
+     * @param keep the number of characters of the word which were already typed
+     */
+    std::vector<hemiola::KeyReport>
+    edit ( std::size_t erase, const std::vector<unsigned int>& keys, std::size_t keep )
+    {
+        hemiola::KeyReport backspace;
+        backspace.setKey ( m_KeyTable->scanToHex ( KEY_BACKSPACE ) );
+
+        std::vector<hemiola::KeyReport> expected;
+        for ( std::size_t i = 0; i < erase; ++i ) {
+            expected.push_back ( backspace );
+            expected.push_back ( hemiola::KeyReport {} );
+        }
+
+        const auto word = reports ( keys );
+        expected.insert ( expected.end(), word.begin() + 2 * keep, word.end() );
+        return expected;
     }
 
 private:
+    hemiola::KeyReport m_Report;
+    std::string m_Config;
     std::shared_ptr<hemiola::KeyTable> m_KeyTable;
     std::shared_ptr<hemiola::KeyChords> m_KeyChords;
     std::shared_ptr<TestOutputHID> m_Output;
@@ -81,13 +208,13 @@ TEST_F ( HemiolaTest, addKeyTest )
 {
     EXPECT_EQ ( this->captured().empty(), true );
 
-    this->addKey ( KEY_H );
-    this->addKey ( KEY_E );
-    this->addKey ( KEY_M );
-    this->addKey ( KEY_I );
-    this->addKey ( KEY_O );
-    this->addKey ( KEY_L );
-    this->addKey ( KEY_A );
+    this->press ( KEY_H );
+    this->press ( KEY_E );
+    this->press ( KEY_M );
+    this->press ( KEY_I );
+    this->press ( KEY_O );
+    this->press ( KEY_L );
+    this->press ( KEY_A );
     EXPECT_EQ ( this->captured().size(), 7u );
     EXPECT_EQ ( this->captured().count ( KEY_H ), 1u );
     EXPECT_EQ ( this->captured().count ( KEY_E ), 1u );
@@ -97,51 +224,281 @@ TEST_F ( HemiolaTest, addKeyTest )
     EXPECT_EQ ( this->captured().count ( KEY_L ), 1u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
 
-    this->addKey ( KEY_SPACE );
+    this->tap ( KEY_SPACE );
+    EXPECT_EQ ( this->captured().empty(), true );
+
+    // releasing the keys of a discarded chord doesn't start a new one
+    this->release ( KEY_H );
+    this->release ( KEY_E );
+    this->release ( KEY_M );
+    this->release ( KEY_I );
+    this->release ( KEY_O );
+    this->release ( KEY_L );
+    this->release ( KEY_A );
     EXPECT_EQ ( this->captured().empty(), true );
 
-    this->addKey ( KEY_RIGHTCTRL );
-    this->addKey ( KEY_C );
-    this->addKey ( KEY_RIGHTCTRL );
+    this->press ( KEY_RIGHTCTRL );
+    this->tap ( KEY_C );
+    this->release ( KEY_RIGHTCTRL );
     EXPECT_EQ ( this->captured().empty(), true );
 
-    this->addKey ( KEY_A );
+    this->press ( KEY_A );
     EXPECT_EQ ( this->captured().size(), 1u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
+    EXPECT_EQ ( this->written().empty(), true );
 }
 
 TEST_F ( HemiolaTest, backspaceKeyTest )
 {
-    this->addKey ( KEY_RIGHTSHIFT );
-    this->addKey ( KEY_A );
-    this->addKey ( KEY_RIGHTSHIFT );
+    this->press ( KEY_RIGHTSHIFT );
+    this->press ( KEY_A );
+    this->release ( KEY_RIGHTSHIFT );
     EXPECT_EQ ( this->captured().size(), 2u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
 
-    this->addKey ( KEY_BACKSPACE );
+    this->tap ( KEY_BACKSPACE );
     EXPECT_EQ ( this->captured().empty(), true );
+    this->release ( KEY_A );
 
-    this->addKey ( KEY_RIGHTSHIFT );
-    this->addKey ( KEY_A );
-    this->addKey ( KEY_B );
-    this->addKey ( KEY_RIGHTSHIFT );
+    this->press ( KEY_RIGHTSHIFT );
+    this->press ( KEY_A );
+    this->press ( KEY_B );
+    this->release ( KEY_RIGHTSHIFT );
     EXPECT_EQ ( this->captured().size(), 3u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
     EXPECT_EQ ( this->captured().count ( KEY_B ), 1u );
 
-    this->addKey ( KEY_BACKSPACE );
+    this->tap ( KEY_BACKSPACE );
     EXPECT_EQ ( this->captured().size(), 2u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
 
-    this->addKey ( KEY_RIGHTSHIFT );
-    this->addKey ( KEY_RIGHTALT );
-    this->addKey ( KEY_A );
-    this->addKey ( KEY_RIGHTALT );
-    this->addKey ( KEY_RIGHTSHIFT );
+    this->press ( KEY_RIGHTSHIFT );
+    this->press ( KEY_RIGHTALT );
+    this->release ( KEY_RIGHTALT );
+    this->release ( KEY_RIGHTSHIFT );
     EXPECT_EQ ( this->captured().size(), 3u );
     EXPECT_EQ ( this->captured().count ( KEY_A ), 1u );
 
-    this->addKey ( KEY_BACKSPACE );
+    this->tap ( KEY_BACKSPACE );
+    EXPECT_EQ ( this->captured().empty(), true );
+}
+
+TEST_F ( HemiolaTest, overlapChordTest )
+{
+    // the chord is output the moment its last key is released
+    this->press ( KEY_B );
+    this->press ( KEY_C );
+    this->release ( KEY_B );
+    EXPECT_EQ ( this->captured().size(), 2u );
+    EXPECT_EQ ( this->written().empty(), true );
+
+    this->release ( KEY_C );
+    EXPECT_EQ ( this->captured().empty(), true );
+    // the host already has the b of because, so only the c is replaced
+    EXPECT_EQ ( this->written(), this->edit ( 1, { KEY_B, KEY_C }, 1 ) );
+}
+
+TEST_F ( HemiolaTest, earlyCommitTest )
+{
+    // no larger chord contains b, c and m so there is no need to wait for a release
+    this->press ( KEY_B );
+    this->press ( KEY_C );
+    EXPECT_EQ ( this->written().empty(), true );
+
+    this->press ( KEY_M );
+    EXPECT_EQ ( this->captured().empty(), true );
+    EXPECT_EQ ( this->written(), this->edit ( 2, { KEY_B, KEY_C, KEY_M }, 1 ) );
+
+    // releasing the keys doesn't output the chord again
+    this->release ( KEY_B );
+    this->release ( KEY_C );
+    this->release ( KEY_M );
+    EXPECT_EQ ( this->written(), this->edit ( 2, { KEY_B, KEY_C, KEY_M }, 1 ) );
+}
+
+TEST_F ( HemiolaTest, minimalEditTest )
+{
+    // keys pressed in the order of the word need no correction at all
+    this->press ( KEY_B );
+    this->press ( KEY_U );
+    this->press ( KEY_S );
+    EXPECT_EQ ( this->captured().empty(), true );
+    EXPECT_EQ ( this->written().empty(), true );
+    this->release ( KEY_B );
+    this->release ( KEY_U );
+    this->release ( KEY_S );
+
+    // otherwise everything after the common prefix is backspaced and retyped
+    this->press ( KEY_S );
+    this->press ( KEY_U );
+    this->press ( KEY_B );
+    EXPECT_EQ ( this->written(), this->edit ( 3, { KEY_B, KEY_U, KEY_S }, 0 ) );
+}
+
+TEST_F ( HemiolaTest, rolledKeysTest )
+{
+    // keys typed one after the other don't overlap so they are separate chords
+    this->tap ( KEY_B );
+    EXPECT_EQ ( this->captured().empty(), true );
+    this->tap ( KEY_C );
+    EXPECT_EQ ( this->captured().empty(), true );
+    EXPECT_EQ ( this->written().empty(), true );
+}
+
+TEST_F ( HemiolaTest, fallbackTest )
+{
+    // a chord which is held down is still output once the time threshold has passed
+    this->press ( KEY_B );
+    this->press ( KEY_C );
+    this->poll ( std::chrono::steady_clock::now() );
+    EXPECT_EQ ( this->written().empty(), true );
+
+    this->poll ( std::chrono::steady_clock::now() + std::chrono::seconds ( 1 ) );
+    EXPECT_EQ ( this->captured().empty(), true );
+    EXPECT_EQ ( this->written(), this->edit ( 1, { KEY_B, KEY_C }, 1 ) );
+
+    // and isn't output a second time when it is released
+    this->release ( KEY_B );
+    this->release ( KEY_C );
+    EXPECT_EQ ( this->written(), this->edit ( 1, { KEY_B, KEY_C }, 1 ) );
+}
+
+TEST_F ( HemiolaTest, withheldAfterCommitTest )
+{
+    // every report is passed on, so the chord is corrected once it is known
+    this->pressKey ( KEY_B );
+    this->pressKey ( KEY_C );
+    this->pressKey ( KEY_M );
+    EXPECT_EQ ( this->written().size(), 3u + this->edit ( 2, { KEY_B, KEY_C, KEY_M }, 1 ).size() );
+
+    // keys of the chord which are still held don't reach the host again
+    this->releaseKey ( KEY_B );
+    EXPECT_EQ ( this->written().back(), hemiola::KeyReport {} );
+    this->releaseKey ( KEY_C );
+    this->releaseKey ( KEY_M );
+    EXPECT_EQ ( this->written().back(), hemiola::KeyReport {} );
+}
+
+TEST_F ( HemiolaTest, holdBackChordTest )
+{
+    this->holdBack();
+
+    // nothing reaches the host until the chord is known, and then there's nothing to correct
+    this->pressKey ( KEY_B );
+    this->pressKey ( KEY_C );
+    this->releaseKey ( KEY_B );
+    EXPECT_EQ ( this->written().empty(), true );
+
+    this->releaseKey ( KEY_C );
+    EXPECT_EQ ( this->written(), this->reports ( { KEY_B, KEY_C } ) );
+}
+
+TEST_F ( HemiolaTest, holdBackTypingTest )
+{
+    this->holdBack();
+
+    // a key which turns out not to be a chord is typed once it is released
+    this->pressKey ( KEY_B );
+    EXPECT_EQ ( this->written().empty(), true );
+    this->releaseKey ( KEY_B );
+    auto expected = std::vector<hemiola::KeyReport> { this->typed ( KEY_B ), {} };
+    EXPECT_EQ ( this->written(), expected );
+
+    // keys which aren't part of any chord are passed on straight away
+    this->pressKey ( KEY_1 );
+    expected.push_back ( this->typed ( KEY_1 ) );
+    EXPECT_EQ ( this->written(), expected );
+    this->releaseKey ( KEY_1 );
+    expected.push_back ( {} );
+
+    // as are shortcuts, after anything which was held back
+    this->pressKey ( KEY_B );
+    this->pressKey ( KEY_LEFTCTRL );
+    expected.push_back ( this->typed ( KEY_B ) );
+    expected.push_back ( {} );
+    hemiola::KeyReport control;
+    control.setModifier ( 0x01 );
+    expected.push_back ( control );
+    EXPECT_EQ ( this->written(), expected );
+}
+
+TEST_F ( HemiolaTest, maxHoldTest )
+{
+    this->holdBack();
+
+    this->pressKey ( KEY_B );
+    this->poll ( std::chrono::steady_clock::now() );
+    EXPECT_EQ ( this->written().empty(), true );
+
+    // a key can't be held back forever
+    this->poll ( std::chrono::steady_clock::now() + std::chrono::seconds ( 1 ) );
+    const auto expected = std::vector<hemiola::KeyReport> { this->typed ( KEY_B ), {} };
+    EXPECT_EQ ( this->written(), expected );
+
+    // and isn't typed a second time when it is released
+    this->releaseKey ( KEY_B );
+    EXPECT_EQ ( this->written(), expected );
+}
+
+TEST_F ( HemiolaTest, heldAcrossReleaseTest )
+{
+    this->holdBack();
+
+    // a key which is down when held back keys are typed stays down, rather than being released
+    // and typed again
+    hemiola::KeyReport space = this->typed ( KEY_SPACE );
+    hemiola::KeyReport spaceB = space;
+    spaceB.setKey ( this->typed ( KEY_B ).keys [0] );
+    this->pressKey ( KEY_SPACE );
+    this->pressKey ( KEY_B );
+    this->releaseKey ( KEY_B );
+    auto expected = std::vector<hemiola::KeyReport> { space, spaceB, space };
+    EXPECT_EQ ( this->written(), expected );
+    this->releaseKey ( KEY_SPACE );
+    expected.push_back ( {} );
+    EXPECT_EQ ( this->written(), expected );
+
+    // the same goes for keys typed once they have been held back for too long
+    this->pressKey ( KEY_SPACE );
+    this->pressKey ( KEY_B );
+    this->poll ( std::chrono::steady_clock::now() + std::chrono::seconds ( 1 ) );
+    expected.insert ( expected.end(), { space, spaceB, space } );
+    EXPECT_EQ ( this->written(), expected );
+    this->releaseKey ( KEY_B );
+    this->releaseKey ( KEY_SPACE );
+    expected.push_back ( {} );
+    EXPECT_EQ ( this->written(), expected );
+}
+
+TEST_F ( HemiolaTest, kernelTimeTest )
+{
+    using namespace std::chrono_literals;
+
+    // keys pressed together are a chord, however late they are processed
+    const auto start = std::chrono::steady_clock::now() - 1min;
+    this->pressAt ( KEY_B, start );
+    this->pressAt ( KEY_C, start + 10ms );
+    EXPECT_EQ ( this->captured().size(), 2u );
+
+    // and a key pressed after the chord timed out starts a new one, even if the timer hasn't
+    // fired yet
+    this->pressAt ( KEY_U, start + 10s );
+    EXPECT_EQ ( this->captured().size(), 1u );
+    EXPECT_EQ ( this->captured().count ( KEY_U ), 1u );
+    EXPECT_EQ ( this->written().empty(), false );
+}
+
+TEST_F ( HemiolaTest, runStopTest )
+{
+    // the timer should sleep while idle and still shut down promptly when asked to
+    const auto start = std::chrono::steady_clock::now();
+    this->run();
+    std::this_thread::sleep_for ( std::chrono::milliseconds ( 20 ) );
+    this->stop();
+    EXPECT_LT ( std::chrono::steady_clock::now() - start, std::chrono::milliseconds ( 200 ) );
+
+    // stopping twice should be harmless
+    this->stop();
     EXPECT_EQ ( this->captured().empty(), true );
 }
 
@@ -0,0 +1,260 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "FakeDeviceProbe.h"
+#include "InputManager.h"
+#include "KeyTable.h"
+#include "KeyboardEvents.h"
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief keyboard whose events are written to a pipe by the test, and which is unplugged by
+ *        closing the pipe
+ */
+class PipeInputHID : public InputHID
+{
+public:
+    PipeInputHID() = default;
+    PipeInputHID ( const PipeInputHID& ) = delete;
+    PipeInputHID ( PipeInputHID&& ) = delete;
+    PipeInputHID& operator= ( const PipeInputHID& ) = delete;
+    PipeInputHID& operator= ( PipeInputHID&& ) = delete;
+    ~PipeInputHID() { close(); }
+
+    void open() override
+    {
+        std::array<int, 2> fds {};
+        ASSERT_EQ ( pipe2 ( fds.data(), O_CLOEXEC ), 0 );
+        m_HIDId = fds [0];
+        m_Write = fds [1];
+        m_Opened = true;
+    }
+
+    void close() override
+    {
+        unplug();
+        HID::close();
+    }
+
+    void read ( input_event& event ) override { read ( &event, 1 ); }
+
+    std::size_t read ( input_event* events, const std::size_t count ) override
+    {
+        const auto bytes = ::read ( m_HIDId, events, sizeof ( input_event ) * count );
+        if ( bytes <= 0 ) {
+            throw IoException ( "Keyboard unplugged", ENODEV );
+        }
+        return static_cast<std::size_t> ( bytes ) / sizeof ( input_event );
+    }
+
+    KeyState keyState() const override { return m_KeyState; }
+
+    bool monotonicTime() const override { return true; }
+
+    void setKeyState ( const KeyState& state ) { m_KeyState = state; }
+
+    /*!
+     * @brief write events for the manager to read, as the keyboard would
+     */
+    void send ( const std::vector<input_event>& events )
+    {
+        const auto bytes = sizeof ( input_event ) * events.size();
+        ASSERT_EQ ( ::write ( m_Write, events.data(), bytes ), static_cast<ssize_t> ( bytes ) );
+    }
+
+    void unplug()
+    {
+        if ( m_Write != -1 ) {
+            ::close ( m_Write );
+            m_Write = -1;
+        }
+    }
+
+private:
+    int m_Write { -1 };
+    KeyState m_KeyState;
+};
+
+static input_event key ( const unsigned short code, const int value, const long usec = 0 )
+{
+    input_event event {};
+    event.input_event_usec = usec;
+    event.type = EV_KEY;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+static input_event report ( const long usec )
+{
+    input_event event {};
+    event.input_event_usec = usec;
+    event.type = EV_SYN;
+    event.code = SYN_REPORT;
+    return event;
+}
+
+/*!
+ * @brief read whatever the manager has ready, as (code, value) pairs
+ */
+static std::vector<std::pair<unsigned short, int>> readEvents ( InputManager& manager )
+{
+    std::array<input_event, 64> events {};
+    const auto count = manager.read ( events.data(), events.size() );
+    std::vector<std::pair<unsigned short, int>> read;
+    for ( std::size_t i = 0; i < count; ++i ) {
+        read.emplace_back ( events [i].code, events [i].value );
+    }
+    return read;
+}
+
+TEST ( InputManagerTest, hotplugTest )
+{
+    using Events = std::vector<std::pair<unsigned short, int>>;
+
+    const auto root = ::testing::TempDir() + "InputManagerTest/";
+    mkdir ( root.c_str(), 0700 );
+
+    auto probe = std::make_shared<FakeDeviceProbe>();
+    std::map<std::string, std::shared_ptr<PipeInputHID>> devices;
+    auto factory = [&devices] ( const std::string& path ) {
+        auto device = std::make_shared<PipeInputHID>();
+        devices [path] = device;
+        return device;
+    };
+    auto plug = [&root, &probe] ( const std::string& file, const DeviceInfo& info ) {
+        probe->setDevice ( root + file, info );
+        std::ofstream ( root + file ).close();
+    };
+
+    plug ( "event0", FakeDeviceProbe::keyboard ( "Keyboard Left" ) );
+    plug ( "event1", FakeDeviceProbe::device ( "Power Button", { KEY_POWER } ) );
+
+    InputManager manager ( root, probe, factory );
+    manager.open();
+    EXPECT_EQ ( manager.keyboards(), 1u );
+    auto& left = *devices [root + "event0"];
+
+    left.send ( { key ( KEY_A, 1 ), report ( 1 ) } );
+    EXPECT_EQ ( readEvents ( manager ), ( Events { { KEY_A, 1 }, { SYN_REPORT, 0 } } ) );
+
+    // the other half of the keyboard is plugged in
+    plug ( "event2", FakeDeviceProbe::keyboard ( "Keyboard Right" ) );
+    EXPECT_TRUE ( readEvents ( manager ).empty() );
+    EXPECT_EQ ( manager.keyboards(), 2u );
+    auto& right = *devices [root + "event2"];
+
+    // frames from both halves come out in the order they happened, not the order they are read
+    right.send ( { key ( KEY_B, 1, 3 ), report ( 3 ) } );
+    left.send ( { key ( KEY_C, 1, 2 ), report ( 2 ) } );
+    EXPECT_EQ ( readEvents ( manager ),
+                ( Events { { KEY_C, 1 }, { SYN_REPORT, 0 }, { KEY_B, 1 }, { SYN_REPORT, 0 } } ) );
+
+    // the held keys are those of both halves
+    InputHID::KeyState leftKeys;
+    leftKeys.set ( KEY_A ).set ( KEY_C );
+    InputHID::KeyState rightKeys;
+    rightKeys.set ( KEY_B );
+    left.setKeyState ( leftKeys );
+    right.setKeyState ( rightKeys );
+    EXPECT_EQ ( manager.keyState(), leftKeys | rightKeys );
+
+    // frames are only handed out once they are complete
+    left.send ( { key ( KEY_D, 1, 4 ) } );
+    EXPECT_TRUE ( readEvents ( manager ).empty() );
+    left.send ( { report ( 4 ) } );
+    EXPECT_EQ ( readEvents ( manager ), ( Events { { KEY_D, 1 }, { SYN_REPORT, 0 } } ) );
+
+    // keys held on a keyboard which is unplugged are released
+    right.unplug();
+    EXPECT_EQ ( readEvents ( manager ), ( Events { { KEY_B, 0 }, { SYN_REPORT, 0 } } ) );
+    EXPECT_EQ ( manager.keyboards(), 1u );
+    EXPECT_EQ ( manager.recovery().count, 0u );
+
+    plug ( "event3", FakeDeviceProbe::keyboard ( "Keyboard Right" ) );
+    EXPECT_TRUE ( readEvents ( manager ).empty() );
+    EXPECT_EQ ( manager.keyboards(), 2u );
+    EXPECT_EQ ( manager.recovery().count, 1u );
+
+    // as are those held on a keyboard whose device is removed, in key code order
+    std::remove ( ( root + "event0" ).c_str() );
+    EXPECT_EQ ( readEvents ( manager ),
+                ( Events { { KEY_A, 0 }, { KEY_D, 0 }, { KEY_C, 0 }, { SYN_REPORT, 0 } } ) );
+    EXPECT_EQ ( manager.keyboards(), 1u );
+
+    // events which don't fit in to a read keep the manager readable, e.g. for the reactor
+    devices [root + "event3"]->send ( { key ( KEY_E, 1, 5 ), report ( 5 ) } );
+    input_event first {};
+    manager.read ( first );
+    EXPECT_EQ ( first.code, KEY_E );
+    pollfd readable { manager.fd(), POLLIN, 0 };
+    EXPECT_EQ ( ::poll ( &readable, 1, 0 ), 1 );
+    EXPECT_EQ ( readEvents ( manager ), ( Events { { SYN_REPORT, 0 } } ) );
+    EXPECT_EQ ( ::poll ( &readable, 1, 0 ), 0 );
+
+    manager.close();
+    for ( const auto* file : { "event1", "event2", "event3" } ) {
+        std::remove ( ( root + file ).c_str() );
+    }
+    std::remove ( root.c_str() );
+}
+
+TEST ( InputManagerTest, stopTest )
+{
+    const auto root = ::testing::TempDir() + "InputManagerStopTest/";
+    mkdir ( root.c_str(), 0700 );
+
+    auto manager = std::make_shared<InputManager> ( root, std::make_shared<FakeDeviceProbe>() );
+    manager->open();
+    KeyboardEvents events ( std::make_shared<KeyTable>(), manager );
+
+    // capture waits for a keyboard to be plugged in, however long it takes, until it is stopped
+    std::exception_ptr error;
+    auto capture = std::thread ( [&events, &error] {
+        events.capture ( [] ( KeyReport, KeyEvent ) {},
+                         [&error] ( std::exception_ptr exc ) { error = exc; } );
+    } );
+    events.stop();
+    capture.join();
+    EXPECT_EQ ( error, nullptr );
+
+    manager->close();
+    std::remove ( root.c_str() );
+}
@@ -0,0 +1,245 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "KeyChords.h"
+#include "KeyMask.h"
+#include "KeyTable.h"
+
+#include <gtest/gtest.h>
+#include <linux/input.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief build a mask from a list of key codes
+ */
+static KeyMask makeMask ( const std::vector<unsigned int>& keys )
+{
+    KeyMask mask;
+    for ( const auto key : keys ) {
+        mask.set ( key );
+    }
+    return mask;
+}
+
+class KeyChordsTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_Config = ::testing::TempDir() + "KeyChordsTest.yml";
+        std::ofstream config ( m_Config );
+        config << "dup: \"=\"\n"
+                  "plural: \";\"\n"
+                  "past: \",\"\n"
+                  "chords:\n"
+                  "  because: bc\n"
+                  "  began: bg + past\n"
+                  "  begin: bg\n"
+                  "  good: god + dup\n"
+                  "  does: do + plural\n"
+                  "  few: fet\n"
+                  "  feet: fet\n"
+                  "  it's: \"it'\"\n"
+                  "  broken: b + nonsense\n"
+                  "  Hi!: hq\n"
+                  "  caf\u00e9: cf\n";
+        config.close();
+
+        m_KeyTable = std::make_shared<KeyTable>();
+        m_KeyChords = std::make_shared<KeyChords> ( m_KeyTable );
+        m_KeyChords->buildMap ( m_Config );
+    }
+
+    void TearDown() override { std::remove ( m_Config.c_str() ); }
+
+    std::string m_Config;
+    std::shared_ptr<KeyTable> m_KeyTable;
+    std::shared_ptr<KeyChords> m_KeyChords;
+};
+
+TEST ( KeyMaskTest, bitOperationsTest )
+{
+    auto mask = makeMask ( { KEY_A, KEY_Z, KEY_F24, 255 } );
+    EXPECT_EQ ( mask.size(), 4u );
+    EXPECT_EQ ( mask.test ( KEY_A ), true );
+    EXPECT_EQ ( mask.test ( KEY_B ), false );
+    EXPECT_EQ ( mask.test ( 256 ), false );
+    EXPECT_EQ ( mask.count ( 255 ), 1u );
+
+    std::vector<unsigned int> keys;
+    mask.forEach ( [&keys] ( const auto key ) { keys.push_back ( key ); } );
+    EXPECT_EQ ( keys, ( std::vector<unsigned int> { KEY_A, KEY_Z, KEY_F24, 255 } ) );
+
+    EXPECT_EQ ( mask.contains ( makeMask ( { KEY_A, KEY_F24 } ) ), true );
+    EXPECT_EQ ( mask.contains ( makeMask ( { KEY_A, KEY_B } ) ), false );
+    EXPECT_EQ ( mask - makeMask ( { KEY_Z, 255 } ), makeMask ( { KEY_A, KEY_F24 } ) );
+
+    mask.reset ( KEY_Z );
+    EXPECT_EQ ( mask.size(), 3u );
+    EXPECT_EQ ( KeyMaskHasher {}( mask ),
+                KeyMaskHasher {}( makeMask ( { KEY_A, KEY_F24, 255 } ) ) );
+
+    mask.clear();
+    EXPECT_EQ ( mask.empty(), true );
+}
+
+TEST_F ( KeyChordsTest, maskLookupTest )
+{
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_B, KEY_C } ) ), "because" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_B, KEY_G } ) ), "begin" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_B, KEY_G, KEY_COMMA } ) ), "began" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_G, KEY_O, KEY_D, KEY_EQUAL } ) ), "good" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_D, KEY_O, KEY_SEMICOLON } ) ), "does" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_I, KEY_T, KEY_APOSTROPHE } ) ), "it's" );
+
+    // the first of two clashing chords wins
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_F, KEY_E, KEY_T } ) ), "few" );
+
+    // unknown chords and chords with unknown specials have no word
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_Q, KEY_Z } ) ), "" );
+    EXPECT_EQ ( m_KeyChords->getWord ( makeMask ( { KEY_B } ) ), "" );
+    EXPECT_EQ ( m_KeyChords->getWord ( KeyMask {} ), "" );
+}
+
+TEST_F ( KeyChordsTest, stringLookupTest )
+{
+    EXPECT_EQ ( m_KeyChords->getWord ( std::string ( "cb" ) ), "because" );
+    EXPECT_EQ ( m_KeyChords->getWord ( std::string ( "bg + past" ) ), "began" );
+    EXPECT_EQ ( m_KeyChords->getWord ( std::string ( "xyz" ) ), "xyz" );
+}
+
+TEST_F ( KeyChordsTest, resolveTest )
+{
+    const KeyReport release {};
+    auto press = [] ( const uint8_t modifiers, const uint8_t key ) {
+        return KeyReport { .modifiers = modifiers,
+                           .keys = KeyArray { key, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+    };
+
+    const auto* its = m_KeyChords->resolve ( makeMask ( { KEY_I, KEY_T, KEY_APOSTROPHE } ) );
+    ASSERT_NE ( its, nullptr );
+    EXPECT_EQ ( m_KeyChords->word ( *its ), "it's" );
+    const auto itsReports = m_KeyChords->reports ( *its );
+    EXPECT_EQ ( ( std::vector<KeyReport> ( itsReports.begin(), itsReports.end() ) ),
+                ( std::vector<KeyReport> { press ( 0x00, 0x0c ),
+                                           release,
+                                           press ( 0x00, 0x17 ),
+                                           release,
+                                           press ( 0x00, 0x34 ),
+                                           release,
+                                           press ( 0x00, 0x16 ),
+                                           release } ) );
+
+    // upper case and shifted characters hold shift
+    const auto* hi = m_KeyChords->resolve ( makeMask ( { KEY_H, KEY_Q } ) );
+    ASSERT_NE ( hi, nullptr );
+    const auto hiReports = m_KeyChords->reports ( *hi );
+    EXPECT_EQ ( ( std::vector<KeyReport> ( hiReports.begin(), hiReports.end() ) ),
+                ( std::vector<KeyReport> { press ( 0x02, 0x0b ),
+                                           release,
+                                           press ( 0x00, 0x0c ),
+                                           release,
+                                           press ( 0x02, 0x1e ),
+                                           release } ) );
+
+    // repeated characters are released in between
+    const auto* good = m_KeyChords->resolve ( makeMask ( { KEY_G, KEY_O, KEY_D, KEY_EQUAL } ) );
+    ASSERT_NE ( good, nullptr );
+    const auto goodReports = m_KeyChords->reports ( *good );
+    EXPECT_EQ ( goodReports.size(), 8u );
+    EXPECT_EQ ( goodReports.begin() [3], release );
+
+    // words which can't be typed are left out of the dictionary
+    EXPECT_EQ ( m_KeyChords->resolve ( makeMask ( { KEY_C, KEY_F } ) ), nullptr );
+    EXPECT_EQ ( m_KeyChords->resolve ( makeMask ( { KEY_Q, KEY_Z } ) ), nullptr );
+}
+
+TEST_F ( KeyChordsTest, reachableTest )
+{
+    EXPECT_EQ ( m_KeyChords->reachable ( KeyMask {} ), 8u );
+    EXPECT_EQ ( m_KeyChords->reachable ( makeMask ( { KEY_B } ) ), 3u );
+    EXPECT_EQ ( m_KeyChords->reachable ( makeMask ( { KEY_B, KEY_G } ) ), 2u );
+    EXPECT_EQ ( m_KeyChords->reachable ( makeMask ( { KEY_B, KEY_G, KEY_COMMA } ) ), 1u );
+    EXPECT_EQ ( m_KeyChords->reachable ( makeMask ( { KEY_B, KEY_Z } ) ), 0u );
+
+    // begin is part of began so it can't be resolved early, but because and began can
+    EXPECT_EQ ( m_KeyChords->resolveUnique ( makeMask ( { KEY_B, KEY_G } ) ), nullptr );
+    EXPECT_EQ (
+        m_KeyChords->word ( *m_KeyChords->resolveUnique ( makeMask ( { KEY_B, KEY_C } ) ) ),
+        "because" );
+    EXPECT_EQ ( m_KeyChords->word ( *m_KeyChords->resolveUnique (
+                    makeMask ( { KEY_B, KEY_G, KEY_COMMA } ) ) ),
+                "began" );
+    EXPECT_EQ ( m_KeyChords->resolveUnique ( makeMask ( { KEY_B } ) ), nullptr );
+}
+
+TEST_F ( KeyChordsTest, imageTest )
+{
+    const auto path = ::testing::TempDir() + "KeyChordsTest.bin";
+    m_KeyChords->saveImage ( path );
+
+    // the compiled dictionary answers exactly as the one built from the settings file
+    KeyChords compiled ( m_KeyTable );
+    compiled.loadImage ( path );
+    for ( const auto& keys : std::vector<std::vector<unsigned int>> {
+              { KEY_B, KEY_C },
+              { KEY_B, KEY_G },
+              { KEY_B, KEY_G, KEY_COMMA },
+              { KEY_I, KEY_T, KEY_APOSTROPHE },
+              { KEY_Q, KEY_Z },
+              { KEY_B },
+              {} } ) {
+        const auto chord = makeMask ( keys );
+        EXPECT_EQ ( compiled.getWord ( chord ), m_KeyChords->getWord ( chord ) );
+        EXPECT_EQ ( compiled.reachable ( chord ), m_KeyChords->reachable ( chord ) );
+    }
+    const auto* its = compiled.resolve ( makeMask ( { KEY_I, KEY_T, KEY_APOSTROPHE } ) );
+    ASSERT_NE ( its, nullptr );
+    EXPECT_EQ ( compiled.reports ( *its ).size(), 8u );
+    // the special keys come from the dictionary too
+    EXPECT_EQ ( compiled.getWord ( std::string ( "bg + past" ) ), "began" );
+
+    // a damaged dictionary is refused rather than read
+    {
+        std::fstream file ( path, std::ios::in | std::ios::out | std::ios::binary );
+        file.seekp ( -1, std::ios::end );
+        file.put ( 'x' );
+    }
+    EXPECT_THROW ( compiled.loadImage ( path ), DictionaryException );
+    std::ofstream ( path, std::ios::trunc ) << "HEMDICT";
+    EXPECT_THROW ( compiled.loadImage ( path ), DictionaryException );
+    std::remove ( path.c_str() );
+    EXPECT_THROW ( compiled.loadImage ( path ), IoException );
+}
+
+TEST_F ( KeyChordsTest, strictTest )
+{
+    // feet and few are both fet, which is only a warning unless the map is built strictly
+    KeyChords strict ( m_KeyTable );
+    EXPECT_THROW ( strict.buildMap ( m_Config, true ), DictionaryException );
+    EXPECT_EQ ( m_KeyChords->getWord ( std::string ( "fet" ) ), "few" );
+}
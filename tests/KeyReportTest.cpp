@@ -0,0 +1,93 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "KeyReport.h"
+#include "USBHID.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+
+using namespace hemiola;
+
+TEST ( KeyReportTest, rolloverTest )
+{
+    KeyReport report;
+    for ( uint8_t key = 0x04; key < 0x0c; ++key ) {
+        EXPECT_EQ ( report.setKey ( key ), key >= 0x0a );
+    }
+    EXPECT_EQ ( report.keys, ( KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } ) );
+    EXPECT_TRUE ( report.overflowed() );
+
+    // keys in rollover aren't added twice, and the lowest moves in to a boot slot once one is
+    // free, so a boot protocol host sees it
+    EXPECT_TRUE ( report.setKey ( 0x0a ) );
+    report.unsetKey ( 0x04 );
+    EXPECT_EQ ( report.keys, ( KeyArray { 0x0a, 0x05, 0x06, 0x07, 0x08, 0x09 } ) );
+    EXPECT_TRUE ( report.setKey ( 0x0b ) );
+    EXPECT_TRUE ( report.overflowed() );
+
+    const auto held = report.held();
+    for ( unsigned int key = 0; key < 256; ++key ) {
+        EXPECT_EQ ( KeyReport::testBit ( held, static_cast<uint8_t> ( key ) ),
+                    key > 0x04 && key < 0x0c );
+    }
+
+    report.unsetKey ( 0x0a );
+    EXPECT_EQ ( report.keys, ( KeyArray { 0x0b, 0x05, 0x06, 0x07, 0x08, 0x09 } ) );
+    report.unsetKey ( 0x0b );
+    EXPECT_FALSE ( report.overflowed() );
+    EXPECT_EQ ( report, ( KeyReport { .keys = KeyArray { 0x00, 0x05, 0x06, 0x07, 0x08, 0x09 } } ) );
+
+    // reports holding the same keys match whichever slots the keys are in
+    EXPECT_EQ ( report, ( KeyReport { .keys = KeyArray { 0x09, 0x08, 0x07, 0x06, 0x05, 0x00 } } ) );
+    EXPECT_FALSE ( report
+                   == ( KeyReport { .modifiers = 0x02,
+                                    .keys = KeyArray { 0x00, 0x05, 0x06, 0x07, 0x08, 0x09 } } ) );
+
+    // reports only match if their rollover does too
+    auto other = report;
+    other.setKey ( 0x04 );
+    other.setKey ( 0xe3 );
+    EXPECT_FALSE ( report == other );
+}
+
+TEST ( KeyReportTest, encodeTest )
+{
+    KeyReport report { .modifiers = 0x02, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } };
+    report.setKey ( 0x0a );
+    report.setKey ( 0x65 );
+
+    USBHID::ReportData data {};
+    EXPECT_EQ ( USBHID::encode ( report, ReportFormat::BOOT, data ), USBHID::BOOT_LENGTH );
+    EXPECT_TRUE ( std::equal ( data.begin(),
+                               data.begin() + USBHID::BOOT_LENGTH,
+                               USBHID::ReportData { 0x02, 0x00, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 }
+                                   .begin() ) );
+
+    // bit i of byte j is usage j * 8 + i, after the modifiers and reserved byte
+    USBHID::ReportData expected {};
+    expected [0] = 0x02;
+    expected [2] = 0xf0;             // 0x04 to 0x07
+    expected [3] = 0x07;             // 0x08 to 0x0a
+    expected [2 + 0x65 / 8] = 0x20;  // 0x65
+    EXPECT_EQ ( USBHID::encode ( report, ReportFormat::NKRO, data ), USBHID::NKRO_LENGTH );
+    EXPECT_EQ ( data, expected );
+}
@@ -19,6 +19,7 @@
 */
 #include "Exceptions.h"
 #include "FakeInputHID.h"
+#include "KeyEvent.h"
 #include "KeyReport.h"
 #include "KeyboardEvents.h"
 #include "Logger.h"
@@ -29,10 +30,13 @@
 #include <linux/input.h>
 #include <spdlog/spdlog.h>
 
+#include <chrono>
 #include <exception>
 #include <iostream>
 #include <queue>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace hemiola;
 
@@ -66,9 +70,73 @@ public:
      */
     void release ( const unsigned short code, const KeyReport& report, bool valid = true )
     {
-        keyEvent ( code, report, false );
+        keyEvent ( code, report, false, valid );
     }
 
+    /*!
+     * @brief add a frame holding several key presses and releases
+     * @param keys the keys and whether they are pressed (true) or released (false)
+     * @param report the expected result after the whole frame
+     * @post every key in the frame is expected with the report for the whole frame
+     */
+    void frame ( const std::vector<std::pair<unsigned short, bool>>& keys, const KeyReport& report )
+    {
+        for ( const auto& [code, press] : keys ) {
+            m_Data.push ( input_event { .type = EV_KEY,
+                                        .code = code,
+                                        .value = press ? EV_MAKE : EV_BREAK } );
+            m_ExpectedReports.push ( report );
+            m_ExpectedKeys.push ( KeyEvent { code, press } );
+        }
+        m_Data.push ( input_event { .type = EV_SYN, .code = SYN_REPORT, .value = 0 } );
+    }
+
+    /*!
+     * @brief add a frame which shouldn't result in any key events, e.g. a key repeat
+     * @param event the event making up the frame
+     */
+    void ignored ( const input_event& event )
+    {
+        m_Data.push ( event );
+        m_Data.push ( input_event { .type = EV_SYN, .code = SYN_REPORT, .value = 0 } );
+    }
+
+    /*!
+     * @brief add a frame which the kernel dropped events from, after which the keyboard reports
+     *        the given keys held
+     * @param held the keys held once the events have been dropped
+     * @param keys the keys expected to be released and pressed to catch up
+     * @param report the expected result
+     * @param partial events of the frame read before the kernel started dropping them
+     */
+    void dropped ( const std::vector<unsigned short>& held,
+                   const std::vector<KeyEvent>& keys,
+                   const KeyReport& report,
+                   const std::vector<input_event>& partial = {} )
+    {
+        for ( const auto& event : partial ) {
+            m_Data.push ( event );
+        }
+        m_Data.push ( input_event { .type = EV_SYN, .code = SYN_DROPPED, .value = 0 } );
+        // whatever is left of the frame is incomplete, so is ignored
+        m_Data.push ( input_event { .type = EV_KEY, .code = KEY_Q, .value = EV_MAKE } );
+        m_Data.push ( input_event { .type = EV_SYN, .code = SYN_REPORT, .value = 0 } );
+
+        for ( const auto key : held ) {
+            m_KeyState.set ( key );
+        }
+        for ( const auto& key : keys ) {
+            m_ExpectedReports.push ( report );
+            m_ExpectedKeys.push ( key );
+        }
+    }
+
+    /*!
+     * @brief add an event without the SYN_REPORT which would finish its frame
+     * @param event the event to simulate
+     */
+    void unfinished ( const input_event& event ) { m_Data.push ( event ); }
+
     /*!
      * @brief run the simulated key presses
      * @post simulated key press data is received
@@ -77,12 +145,13 @@ public:
     {
         auto device = std::make_shared<FakeInputHID>();
         device->setData ( m_Data );
+        device->setKeyState ( m_KeyState );
 
         auto keyTable = std::make_shared<KeyTable>();
 
         KeyboardEvents keys ( keyTable, device );
         // all data should be passed to output initially
-        auto onEvent = [this] ( KeyReport report, unsigned int key ) {
+        auto onEvent = [this] ( KeyReport report, KeyEvent key ) {
             m_ReceivedReports.push ( report );
             m_ReceivedKeys.push ( key );
         };
@@ -92,6 +161,7 @@ public:
 
         // normally this would be run in its own thread
         keys.capture ( onEvent, onError );
+        m_Drops = keys.drops();
     }
 
     /*!
@@ -164,9 +234,16 @@ private:
      */
     void addData ( input_event event, KeyReport report, bool valid = true )
     {
+        // keyboards send the scan code ahead of the key, and end each frame with a SYN_REPORT
+        m_Data.push ( input_event { .type = EV_MSC, .code = MSC_SCAN, .value = event.code } );
         m_Data.push ( event );
-        m_ExpectedReports.push ( report );
-        m_ExpectedKeys.push ( valid ? event.code : 0u );
+        m_Data.push ( input_event { .type = EV_SYN, .code = SYN_REPORT, .value = 0 } );
+
+        // invalid keys don't change the report so nothing is passed on for them
+        if ( valid ) {
+            m_ExpectedReports.push ( report );
+            m_ExpectedKeys.push ( KeyEvent { event.code, event.value == EV_MAKE } );
+        }
     }
 
     /*!
@@ -180,11 +257,11 @@ private:
     /*!
      * @brief the expected keys from simulated key presses
      */
-    std::queue<unsigned int> m_ExpectedKeys;
+    std::queue<KeyEvent> m_ExpectedKeys;
     /*!
      * @brief the expected keys from simulated key presses
      */
-    std::queue<unsigned int> m_ReceivedKeys;
+    std::queue<KeyEvent> m_ReceivedKeys;
     /*!
      * @brief any exception received during the simulation
      */
@@ -193,6 +270,16 @@ private:
      * @brief key presses to be simulated
      */
     std::queue<input_event> m_Data;
+    /*!
+     * @brief keys the simulated keyboard reports as held after events are dropped
+     */
+    InputHID::KeyState m_KeyState;
+
+public:
+    /*!
+     * @brief number of times events were dropped during the simulation
+     */
+    std::size_t m_Drops { 0 };
 };
 
 TEST_F ( KeyboardEventTest, InvalidKeyCodeTest )
@@ -357,15 +444,15 @@ TEST_F ( KeyboardEventTest, OverflowTest )
     this->press (
         KEY_F,
         KeyReport { .modifiers = 0x04, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } } );
-    // no more than 6 keys can be pressed at once
-    this->press (
-        KEY_G,
-        KeyReport { .modifiers = 0x04, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } },
-        false );
+    // no more than 6 keys fit in a boot protocol report, the rest are kept in rollover
+    auto rolledOver
+        = KeyReport { .modifiers = 0x04, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } };
+    rolledOver.setKey ( 0x0a );
+    EXPECT_TRUE ( rolledOver.overflowed() );
+    this->press ( KEY_G, rolledOver );
     this->release (
         KEY_G,
-        KeyReport { .modifiers = 0x04, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } },
-        false );
+        KeyReport { .modifiers = 0x04, .keys = KeyArray { 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 } } );
     // now release our keys
     this->release (
         KEY_A,
@@ -393,3 +480,109 @@ TEST_F ( KeyboardEventTest, OverflowTest )
     // verify that all data was received
     this->checkData();
 }
+
+TEST_F ( KeyboardEventTest, FrameTest )
+{
+    // keys pressed in the same frame are passed on with the report for the whole frame
+    const auto both
+        = KeyReport { .modifiers = 0x02, .keys = KeyArray { 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+    this->frame ( { { KEY_LEFTSHIFT, true }, { KEY_A, true } }, both );
+
+    // repeats and events which aren't keys don't produce a report
+    this->ignored ( input_event { .type = EV_KEY, .code = KEY_A, .value = EV_REPEAT } );
+    this->ignored ( input_event { .type = EV_MSC, .code = MSC_SCAN, .value = 0x70004 } );
+
+    this->frame ( { { KEY_A, false }, { KEY_LEFTSHIFT, false } }, KeyReport {} );
+
+    // a frame which isn't finished before the keyboard goes away is never passed on
+    this->unfinished ( input_event { .type = EV_KEY, .code = KEY_B, .value = EV_MAKE } );
+
+    this->run();
+    this->checkException();
+    this->checkData();
+}
+
+TEST_F ( KeyboardEventTest, DroppedTest )
+{
+    this->press (
+        KEY_LEFTSHIFT,
+        KeyReport { .modifiers = 0x02, .keys = KeyArray { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } } );
+    this->press (
+        KEY_A,
+        KeyReport { .modifiers = 0x02, .keys = KeyArray { 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 } } );
+
+    // shift and a were released and b and c pressed while events were being dropped
+    const auto resynced
+        = KeyReport { .modifiers = 0x00, .keys = KeyArray { 0x06, 0x05, 0x00, 0x00, 0x00, 0x00 } };
+    this->dropped ( { KEY_B, KEY_C },
+                    { KeyEvent { KEY_A, false },
+                      KeyEvent { KEY_LEFTSHIFT, false },
+                      KeyEvent { KEY_C, true },
+                      KeyEvent { KEY_B, true } },
+                    resynced );
+
+    this->release (
+        KEY_C,
+        KeyReport { .modifiers = 0x00, .keys = KeyArray { 0x00, 0x05, 0x00, 0x00, 0x00, 0x00 } } );
+    this->release ( KEY_B, KeyReport {} );
+
+    this->run();
+    this->checkException();
+    this->checkData();
+    EXPECT_EQ ( this->m_Drops, 1u );
+}
+
+TEST_F ( KeyboardEventTest, PartialFrameDroppedTest )
+{
+    this->press (
+        KEY_A,
+        KeyReport { .modifiers = 0x00, .keys = KeyArray { 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 } } );
+
+    // a was released and d pressed in a frame which was cut short by the drop, so neither was
+    // passed on before it and both have to be caught up on
+    const auto resynced
+        = KeyReport { .modifiers = 0x00, .keys = KeyArray { 0x07, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+    this->dropped ( { KEY_D },
+                    { KeyEvent { KEY_A, false }, KeyEvent { KEY_D, true } },
+                    resynced,
+                    { input_event { .type = EV_KEY, .code = KEY_A, .value = EV_BREAK },
+                      input_event { .type = EV_KEY, .code = KEY_D, .value = EV_MAKE } } );
+
+    this->release ( KEY_D, KeyReport {} );
+
+    this->run();
+    this->checkException();
+    this->checkData();
+    EXPECT_EQ ( this->m_Drops, 1u );
+}
+
+TEST ( KeyboardEventTimeTest, kernelTimeTest )
+{
+    using namespace std::chrono;
+
+    input_event press { .type = EV_KEY, .code = KEY_A, .value = EV_MAKE };
+    press.input_event_sec = 12;
+    press.input_event_usec = 345;
+    std::queue<input_event> data;
+    data.push ( press );
+    data.push ( input_event { .type = EV_SYN, .code = SYN_REPORT, .value = 0 } );
+
+    std::vector<KeyEvent> keys;
+    auto onEvent = [&keys] ( KeyReport, KeyEvent key ) { keys.push_back ( key ); };
+
+    // keys carry the time the kernel saw them
+    auto device = std::make_shared<FakeInputHID>();
+    device->setData ( data );
+    device->setMonotonicTime ( true );
+    KeyboardEvents events ( std::make_shared<KeyTable>(), device );
+    events.captureEvents ( onEvent );
+    ASSERT_EQ ( keys.size(), 1u );
+    EXPECT_EQ ( keys [0].time, KeyEvent::TimePoint { seconds ( 12 ) + microseconds ( 345 ) } );
+
+    // unless that time isn't on the steady clock
+    device->setData ( data );
+    device->setMonotonicTime ( false );
+    events.captureEvents ( onEvent );
+    ASSERT_EQ ( keys.size(), 2u );
+    EXPECT_EQ ( keys [1].time, KeyEvent::TimePoint {} );
+}
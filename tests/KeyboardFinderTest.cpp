@@ -0,0 +1,97 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "FakeDeviceProbe.h"
+#include "KeyboardFinder.h"
+
+#include <gtest/gtest.h>
+
+#include <linux/input.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace hemiola;
+
+static const auto& device = FakeDeviceProbe::device;
+static const auto& keyboard = FakeDeviceProbe::keyboard;
+
+TEST ( KeyboardFinderTest, scoreTest )
+{
+    // power buttons and mice send key events too, but are no keyboard
+    EXPECT_EQ ( KeyboardFinder::score ( device ( "Power Button", { KEY_POWER } ) ), 0u );
+    EXPECT_EQ ( KeyboardFinder::score ( device ( "Keyboard", { KEY_ESC, KEY_1, KEY_2 } ) ), 0u );
+
+    const auto plain = KeyboardFinder::score ( keyboard ( "Generic USB" ) );
+    EXPECT_GT ( plain, 0u );
+    EXPECT_EQ ( KeyboardFinder::score ( keyboard ( "Generic USB Keyboard" ) ), plain + 100 );
+    EXPECT_EQ ( KeyboardFinder::score ( keyboard ( "KEYBOARD" ) ), plain + 100 );
+
+    // a virtual keyboard loses out to a real one, even if it calls itself a keyboard
+    const auto virtualKeyboard = FakeDeviceProbe::virtualKeyboard ( "Virtual Keyboard" );
+    EXPECT_GT ( KeyboardFinder::score ( virtualKeyboard ), 0u );
+    EXPECT_LT ( KeyboardFinder::score ( virtualKeyboard ), plain );
+    auto noVendor = keyboard ( "Keyboard" );
+    noVendor.vendor = 0;
+    EXPECT_LT ( KeyboardFinder::score ( noVendor ), plain );
+}
+
+TEST ( KeyboardFinderTest, findTest )
+{
+    const auto root = ::testing::TempDir() + "KeyboardFinderTest/";
+    mkdir ( root.c_str(), 0700 );
+    for ( const auto* file : { "event0", "event1", "event2", "event3", "mouse0" } ) {
+        std::ofstream ( root + file ).close();
+    }
+
+    auto probe = std::make_shared<FakeDeviceProbe>();
+    probe->setDevice ( root + "event0", device ( "Power Button", { KEY_POWER } ) );
+    probe->setDevice ( root + "event1", keyboard ( "Consumer Control" ) );
+    probe->setDevice ( root + "event2", keyboard ( "Generic USB Keyboard" ) );
+    // not a device the kernel lists as an event handler
+    probe->setDevice ( root + "mouse0", keyboard ( "Mouse Keyboard" ) );
+
+    // the device calling itself a keyboard wins, and the root's trailing slash is optional
+    EXPECT_EQ ( KeyboardFinder ( root.substr ( 0, root.size() - 1 ), probe ).find(),
+                root + "event2" );
+
+    // ties go to the first device
+    probe->setDevice ( root + "event2", keyboard ( "Consumer Control" ) );
+    EXPECT_EQ ( KeyboardFinder ( root, probe ).find(), root + "event1" );
+
+    // split keyboards show up as several devices, all of which are wanted
+    const std::vector<std::string> keyboards { root + "event1", root + "event2" };
+    EXPECT_EQ ( KeyboardFinder ( root, probe ).findAll(), keyboards );
+
+    // nothing which looks like a keyboard
+    probe->setDevice ( root + "event1", std::nullopt );
+    probe->setDevice ( root + "event2", std::nullopt );
+    EXPECT_THROW ( KeyboardFinder ( root, probe ).find(), KeyboardException );
+
+    for ( const auto* file : { "event0", "event1", "event2", "event3", "mouse0" } ) {
+        std::remove ( ( root + file ).c_str() );
+    }
+    std::remove ( root.c_str() );
+
+    EXPECT_THROW ( KeyboardFinder ( root, probe ).find(), KeyboardException );
+}
@@ -0,0 +1,94 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Exceptions.h"
+#include "KeyMask.h"
+#include "PerfectHash.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief count different chords of three to five random keys
+ */
+static std::vector<PerfectSlot> randomChords ( const std::size_t count, const unsigned int seed )
+{
+    std::mt19937 random ( seed );
+    std::uniform_int_distribution<unsigned int> keys ( 1, KeyMask::SIZE - 1 );
+    std::uniform_int_distribution<std::size_t> sizes ( 3, 5 );
+    std::set<KeyMask::Words> seen;
+    std::vector<PerfectSlot> chords;
+    while ( chords.size() < count ) {
+        KeyMask chord;
+        for ( auto size = sizes ( random ); size > 0; --size ) {
+            chord.set ( keys ( random ) );
+        }
+        if ( seen.insert ( chord.words ).second ) {
+            chords.push_back (
+                PerfectSlot { chord.words, static_cast<uint32_t> ( chords.size() ) } );
+        }
+    }
+    return chords;
+}
+
+TEST ( PerfectHashTest, lookupTest )
+{
+    for ( const std::size_t count : { 0, 1, 7, 300, 2000 } ) {
+        const auto chords = randomChords ( count, 1 );
+        const auto table = PerfectTable::build ( chords );
+        const auto slotOf = [&table] ( const KeyMask::Words& chord ) -> const PerfectSlot& {
+            return table.slots [table.hash.find ( chord, table.displacements.data() )];
+        };
+
+        // at most half full, and every chord is found with a single compare
+        EXPECT_GE ( table.slots.size(), 2 * count );
+        EXPECT_EQ ( table.slots.size(), table.hash.slotCount() );
+        EXPECT_EQ ( table.displacements.size(), table.hash.bucketCount() );
+        std::set<KeyMask::Words> inTable;
+        for ( const auto& chord : chords ) {
+            ASSERT_TRUE ( slotOf ( chord.chord ).holds ( chord.chord ) );
+            EXPECT_EQ ( slotOf ( chord.chord ).entry, chord.entry );
+            inTable.insert ( chord.chord );
+        }
+
+        // any other chord lands on a slot holding something else
+        for ( const auto& other : randomChords ( 500, 2 ) ) {
+            if ( inTable.count ( other.chord ) == 0 ) {
+                EXPECT_FALSE ( slotOf ( other.chord ).holds ( other.chord ) );
+            }
+        }
+        EXPECT_FALSE ( slotOf ( KeyMask::Words {} ).holds ( KeyMask::Words {} ) );
+    }
+}
+
+TEST ( PerfectHashTest, invalidTest )
+{
+    auto chords = randomChords ( 10, 1 );
+    chords.push_back ( chords.front() );
+    EXPECT_THROW ( PerfectTable::build ( chords ), DictionaryException );
+
+    chords.back() = PerfectSlot { KeyMask::Words {}, 10 };
+    EXPECT_THROW ( PerfectTable::build ( chords ), DictionaryException );
+}
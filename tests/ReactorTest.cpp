@@ -0,0 +1,220 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "Reactor.h"
+
+#include "BufferedOutputHID.h"
+#include "Exceptions.h"
+#include "Hemiola.h"
+#include "InputHID.h"
+#include "KeyChords.h"
+#include "KeyTable.h"
+#include "KeyboardEvents.h"
+#include "USBHID.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief input device reading events from a pipe, which are stamped with CLOCK_MONOTONIC
+ */
+class PipeInputHID : public InputHID
+{
+public:
+    PipeInputHID()
+    {
+        std::array<int, 2> ends {};
+        if ( pipe2 ( ends.data(), O_NONBLOCK | O_CLOEXEC ) == -1 ) {
+            throw IoException ( "Unable to create pipe", errno );
+        }
+        m_HIDId = ends [0];
+        m_WriteId = ends [1];
+        m_Opened = true;
+    }
+    PipeInputHID ( const PipeInputHID& ) = delete;
+    PipeInputHID ( PipeInputHID&& ) = delete;
+    PipeInputHID& operator= ( const PipeInputHID& ) = delete;
+    PipeInputHID& operator= ( PipeInputHID&& ) = delete;
+    ~PipeInputHID() { ::close ( m_WriteId ); }
+
+    void open() override
+    { /* no opt */
+    }
+
+    void read ( input_event& event ) override { read ( &event, 1 ); }
+
+    std::size_t read ( input_event* events, const std::size_t count ) override
+    {
+        const auto bytes = ::read ( m_HIDId, events, count * sizeof ( input_event ) );
+        if ( bytes == -1 ) {
+            if ( errno == EAGAIN || errno == EINTR ) {
+                return 0;
+            }
+            throw IoException ( "Unable to read from pipe", errno );
+        }
+        return static_cast<std::size_t> ( bytes ) / sizeof ( input_event );
+    }
+
+    bool monotonicTime() const override { return true; }
+
+    /*!
+     * @brief send events as the kernel would, all at once
+     */
+    void send ( const std::vector<input_event>& events )
+    {
+        const auto size = events.size() * sizeof ( input_event );
+        ASSERT_EQ ( ::write ( m_WriteId, events.data(), size ), static_cast<ssize_t> ( size ) );
+    }
+
+private:
+    int m_WriteId { -1 };
+};
+
+class ReactorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_Config = ::testing::TempDir() + "ReactorTest.yml";
+        std::ofstream config ( m_Config );
+        config << "chords:\n"
+                  "  because: bc\n";
+        config.close();
+
+        // the output is a fifo, read here in place of the host
+        m_Fifo = ::testing::TempDir() + "ReactorTest.fifo";
+        std::remove ( m_Fifo.c_str() );
+        ASSERT_EQ ( mkfifo ( m_Fifo.c_str(), 0600 ), 0 );
+        m_HostId = ::open ( m_Fifo.c_str(), O_RDONLY | O_NONBLOCK );
+        ASSERT_NE ( m_HostId, -1 );
+    }
+
+    void TearDown() override
+    {
+        ::close ( m_HostId );
+        std::remove ( m_Fifo.c_str() );
+        std::remove ( m_Config.c_str() );
+    }
+
+public:
+    /*!
+     * @brief a key event stamped the given time before now
+     */
+    static input_event keyEvent ( const unsigned short type,
+                                  const unsigned short code,
+                                  const int value,
+                                  const std::chrono::microseconds ago )
+    {
+        timespec now {};
+        clock_gettime ( CLOCK_MONOTONIC, &now );
+        const auto usec = now.tv_sec * 1000000L + now.tv_nsec / 1000L - ago.count();
+
+        input_event event {};
+        event.input_event_sec = usec / 1000000L;
+        event.input_event_usec = usec % 1000000L;
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        return event;
+    }
+
+    /*!
+     * @brief wait for the given number of boot reports to reach the host
+     */
+    std::size_t readReports ( const std::size_t count )
+    {
+        std::size_t reports = 0;
+        std::array<uint8_t, USBHID::BOOT_LENGTH> data {};
+        while ( reports < count ) {
+            pollfd host { m_HostId, POLLIN, 0 };
+            if ( ::poll ( &host, 1, 5000 ) <= 0 ) {
+                break;
+            }
+            if ( ::read ( m_HostId, data.data(), data.size() )
+                 == static_cast<ssize_t> ( data.size() ) ) {
+                ++reports;
+            }
+        }
+        return reports;
+    }
+
+    std::string m_Config;
+    std::string m_Fifo;
+    int m_HostId { -1 };
+};
+
+TEST_F ( ReactorTest, latencyTest )
+{
+    using namespace std::chrono_literals;
+
+    auto keys = std::make_shared<KeyTable>();
+    auto chords = std::make_shared<KeyChords> ( keys );
+    chords->buildMap ( m_Config );
+
+    auto input = std::make_shared<PipeInputHID>();
+    auto device = std::make_shared<USBHID> ( m_Fifo );
+    device->open();
+    auto output = std::make_shared<BufferedOutputHID> ( device );
+    auto hemiola = std::make_shared<Hemiola> ( keys, chords, output );
+    auto events = std::make_shared<KeyboardEvents> ( keys, input );
+
+    Reactor reactor ( events, input, hemiola, output );
+    std::exception_ptr error;
+    auto loop = std::thread ( [&reactor, &error] {
+        try {
+            reactor.run();
+        } catch ( ... ) {
+            error = std::current_exception();
+        }
+    } );
+
+    // the kernel saw the key a while before it was read, which counts towards its latency
+    const auto ago = 50ms;
+    input->send ( { keyEvent ( EV_KEY, KEY_B, 1, ago ),
+                    keyEvent ( EV_SYN, SYN_REPORT, 0, ago ),
+                    keyEvent ( EV_KEY, KEY_B, 0, ago ),
+                    keyEvent ( EV_SYN, SYN_REPORT, 0, ago ) } );
+    EXPECT_EQ ( readReports ( 2 ), 2u );
+
+    reactor.stop();
+    loop.join();
+    ASSERT_EQ ( error, nullptr );
+
+    const auto& latency = reactor.latency();
+    EXPECT_EQ ( latency.count, 2u );
+    EXPECT_GE ( latency.min, ago );
+}
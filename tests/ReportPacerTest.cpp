@@ -0,0 +1,51 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "ReportPacer.h"
+
+#include "KeyReport.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+using namespace hemiola;
+
+TEST ( ReportPacerTest, editTest )
+{
+    using namespace std::chrono_literals;
+
+    ReportPacer pacer { 1ms };
+    KeyReport backspace;
+    backspace.setKey ( ReportPacer::BACKSPACE );
+    KeyReport a;
+    a.setKey ( 0x04 );
+
+    // the backspaces correcting the word before are written but aren't typed characters
+    auto now = std::chrono::steady_clock::time_point {};
+    for ( const auto& report : { backspace, KeyReport {}, backspace, KeyReport {}, a } ) {
+        pacer.written ( report, true, false, now );
+        now += 1ms;
+    }
+    pacer.written ( KeyReport {}, true, true, now );
+
+    EXPECT_EQ ( pacer.characters, 1u );
+    EXPECT_EQ ( pacer.typing, 5ms );
+    EXPECT_DOUBLE_EQ ( pacer.charactersPerSecond(), 200.0 );
+}
@@ -0,0 +1,150 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "BufferedOutputHID.h"
+#include "KeyReport.h"
+#include "OutputHID.h"
+#include "ReportQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace hemiola;
+
+/*!
+ * @brief output device which only accepts reports while the host is polling
+ */
+class PollingOutputHID : public OutputHID
+{
+public:
+    PollingOutputHID() = default;
+    PollingOutputHID ( const PollingOutputHID& ) = delete;
+    PollingOutputHID ( PollingOutputHID&& ) = delete;
+    PollingOutputHID& operator= ( const PollingOutputHID& ) = delete;
+    PollingOutputHID& operator= ( PollingOutputHID&& ) = delete;
+    ~PollingOutputHID() = default;
+
+    void open() override
+    { /* no opt */
+    }
+
+    void write ( const KeyReport& report ) const override { m_Written.push_back ( report ); }
+
+    bool tryWrite ( const KeyReport& report ) const override
+    {
+        if ( !m_Polling ) {
+            return false;
+        }
+        write ( report );
+        return true;
+    }
+
+    bool m_Polling { true };
+    mutable std::vector<KeyReport> m_Written;
+};
+
+/*!
+ * @brief a report with the given keys held
+ */
+static KeyReport press ( const std::vector<uint8_t>& keys, const uint8_t modifiers = 0x00 )
+{
+    KeyReport report;
+    report.modifiers = modifiers;
+    for ( const auto key : keys ) {
+        report.setKey ( key );
+    }
+    return report;
+}
+
+/*!
+ * @brief take everything out of a queue
+ */
+static std::vector<KeyReport> drain ( ReportQueue& queue )
+{
+    std::vector<KeyReport> reports;
+    while ( !queue.empty() ) {
+        reports.push_back ( queue.front().report );
+        queue.pop();
+    }
+    return reports;
+}
+
+TEST ( ReportQueueTest, coalesceTest )
+{
+    const auto now = std::chrono::steady_clock::now();
+    ReportQueue queue ( 4 );
+
+    // a, then b rolled over a, then a released
+    queue.push ( press ( { 0x04 } ), now );
+    queue.push ( press ( { 0x04, 0x05 } ), now );
+    queue.push ( press ( { 0x05 } ), now );
+    queue.push ( KeyReport {}, now );
+    EXPECT_EQ ( queue.size(), 4u );
+    EXPECT_EQ ( queue.coalesced(), 0u );
+
+    // the roll over and the release of b can go without losing a key press
+    queue.push ( press ( { 0x06 }, 0x02 ), now );
+    EXPECT_EQ ( queue.coalesced(), 2u );
+    EXPECT_EQ ( drain ( queue ),
+                ( std::vector<KeyReport> {
+                    press ( { 0x04 } ), press ( { 0x05 } ), press ( { 0x06 }, 0x02 ) } ) );
+}
+
+TEST ( ReportQueueTest, repeatedKeyTest )
+{
+    const auto now = std::chrono::steady_clock::now();
+    ReportQueue queue ( 3 );
+
+    // the releases between repeated presses of a key are what make the host see each press
+    for ( int i = 0; i < 2; ++i ) {
+        queue.push ( press ( { 0x04 } ), now );
+        queue.push ( KeyReport {}, now );
+    }
+    EXPECT_EQ ( queue.coalesced(), 0u );
+    EXPECT_EQ ( queue.dropped(), 2u );
+
+    // the oldest report may be being written and the newest is what the host ends up with
+    EXPECT_EQ ( drain ( queue ), ( std::vector<KeyReport> { press ( { 0x04 } ), KeyReport {} } ) );
+}
+
+TEST ( ReportQueueTest, backpressureTest )
+{
+    auto device = std::make_shared<PollingOutputHID>();
+    BufferedOutputHID output ( device );
+
+    output.write ( press ( { 0x04 } ) );
+    output.write ( KeyReport {} );
+
+    // reports the host isn't ready for stay queued
+    device->m_Polling = false;
+    output.flush();
+    EXPECT_TRUE ( output.pending() );
+    EXPECT_TRUE ( device->m_Written.empty() );
+
+    device->m_Polling = true;
+    output.flush();
+    output.flush();
+    EXPECT_FALSE ( output.pending() );
+    EXPECT_EQ ( device->m_Written,
+                ( std::vector<KeyReport> { press ( { 0x04 } ), KeyReport {} } ) );
+    EXPECT_EQ ( output.latency().count, 2u );
+}
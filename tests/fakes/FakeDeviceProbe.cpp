@@ -0,0 +1,70 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#include "FakeDeviceProbe.h"
+
+#include <linux/input.h>
+
+using namespace hemiola;
+
+std::optional<DeviceInfo> hemiola::FakeDeviceProbe::probe ( const std::string& path ) const
+{
+    const auto device = m_Devices.find ( path );
+    if ( device == m_Devices.end() ) {
+        return std::nullopt;
+    }
+    return device->second;
+}
+
+void hemiola::FakeDeviceProbe::setDevice ( const std::string& path,
+                                           const std::optional<DeviceInfo>& info )
+{
+    if ( info ) {
+        m_Devices [path] = *info;
+    } else {
+        m_Devices.erase ( path );
+    }
+}
+
+DeviceInfo hemiola::FakeDeviceProbe::device ( const std::string& name,
+                                              std::initializer_list<unsigned int> keys )
+{
+    DeviceInfo info { name, {} };
+    for ( const auto key : keys ) {
+        info.keys.set ( key );
+    }
+    return info;
+}
+
+DeviceInfo hemiola::FakeDeviceProbe::keyboard ( const std::string& name )
+{
+    DeviceInfo info { name, {}, BUS_USB, 0x046d };
+    for ( unsigned int key = KEY_ESC; key <= KEY_KPDOT; ++key ) {
+        info.keys.set ( key );
+    }
+    return info;
+}
+
+DeviceInfo hemiola::FakeDeviceProbe::virtualKeyboard ( const std::string& name )
+{
+    auto info = keyboard ( name );
+    info.bus = BUS_VIRTUAL;
+    info.vendor = 0;
+    return info;
+}
@@ -49,6 +49,20 @@ void hemiola::FakeInputHID::read ( input_event& event )
     }
 }
 
+std::size_t hemiola::FakeInputHID::read ( input_event* events, const std::size_t count )
+{
+    if ( m_Data.empty() ) {
+        throw IoException ( "No more data to read.", 42 );
+    }
+
+    std::size_t read = 0;
+    for ( ; read < count && !m_Data.empty(); ++read ) {
+        events [read] = m_Data.front();
+        m_Data.pop();
+    }
+    return read;
+}
+
 void hemiola::FakeInputHID::setData ( const std::queue<input_event>& events )
 {
     m_Data = events;
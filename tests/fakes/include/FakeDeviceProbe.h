@@ -0,0 +1,79 @@
+/*
+  MIT License
+  Copyright (c) 2021-2022 Erich L Foster
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#pragma once
+
+#include "KeyboardFinder.h"
+
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace hemiola
+{
+    /*!
+     * @brief Class which spoofs DeviceProbe for testing purposes, answering from a table
+     */
+    class FakeDeviceProbe : public DeviceProbe
+    {
+    public:
+        FakeDeviceProbe() = default;
+        FakeDeviceProbe ( const FakeDeviceProbe& ) = delete;
+        FakeDeviceProbe ( FakeDeviceProbe&& ) = delete;
+        FakeDeviceProbe& operator= ( const FakeDeviceProbe& ) = delete;
+        FakeDeviceProbe& operator= ( FakeDeviceProbe&& ) = delete;
+        ~FakeDeviceProbe() = default;
+
+        /*!
+         * @brief what was set for the device with setDevice
+         */
+        std::optional<DeviceInfo> probe ( const std::string& path ) const override;
+
+        /*!
+         * @brief sets what a device says about itself
+         * @param path the device
+         * @param info what the device says, or nothing for a device which can't be opened
+         */
+        void setDevice ( const std::string& path, const std::optional<DeviceInfo>& info );
+
+        /*!
+         * @brief a device with the given name which can send the given keys
+         */
+        static DeviceInfo device ( const std::string& name,
+                                   std::initializer_list<unsigned int> keys );
+
+        /*!
+         * @brief a USB device with the given name which can send every key on a full keyboard
+         */
+        static DeviceInfo keyboard ( const std::string& name );
+
+        /*!
+         * @brief a device made with uinput with the given name which can send every key on a
+         *        full keyboard
+         */
+        static DeviceInfo virtualKeyboard ( const std::string& name );
+
+    private:
+        /*!
+         * @brief what each device says about itself
+         */
+        std::map<std::string, DeviceInfo> m_Devices;
+    };
+}  // namespace hemiola
@@ -21,6 +21,7 @@
 
 #include "InputHID.h"
 
+#include <cstddef>
 #include <queue>
 
 namespace hemiola
@@ -58,6 +59,38 @@ namespace hemiola
          */
         void read ( input_event& event ) override;
 
+        /*!
+         * @brief read as many of the remaining events as fit
+         * @param events where to save the events
+         * @param count the most events to read
+         * @return the number of events read
+         * @throw IoException if there is no more data to read
+         * @assumption device has been opened for reading
+         */
+        std::size_t read ( input_event* events, const std::size_t count ) override;
+
+        /*!
+         * @brief the keys set by setKeyState
+         */
+        KeyState keyState() const override { return m_KeyState; }
+
+        /*!
+         * @brief sets the keys reported as held down by keyState
+         * @param state the keys which are held
+         */
+        void setKeyState ( const KeyState& state ) { m_KeyState = state; }
+
+        /*!
+         * @brief whatever was set by setMonotonicTime, false by default
+         */
+        bool monotonicTime() const override { return m_Monotonic; }
+
+        /*!
+         * @brief sets whether the events sent are said to be stamped with CLOCK_MONOTONIC
+         * @param monotonic true if the event timestamps are monotonic
+         */
+        void setMonotonicTime ( const bool monotonic ) { m_Monotonic = monotonic; }
+
         /*!
          * @brief sets the data to send to whatever calls read
          * @param events the events to stream
@@ -69,5 +102,15 @@ namespace hemiola
          * @brief data to be output from read
          */
         std::queue<input_event> m_Data;
+
+        /*!
+         * @brief keys reported as held down
+         */
+        KeyState m_KeyState;
+
+        /*!
+         * @brief flag indicating if the events are said to be stamped with CLOCK_MONOTONIC
+         */
+        bool m_Monotonic { false };
     };
 }  // namespace hemiola